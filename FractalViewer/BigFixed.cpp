@@ -0,0 +1,240 @@
+#include "BigFixed.h"
+#include <algorithm>
+#include <cmath>
+
+
+BigFixed::BigFixed() {
+    this->limbs.assign(2, 0);
+    this->negative = false;
+}
+
+// Converts exactly as long as the fraction limbs reach the lowest set bit of value.
+BigFixed::BigFixed(double value, int limbCount) {
+    this->limbs.assign(max(limbCount, 2), 0);
+    this->negative = value < 0;
+    double magnitude = fabs(value);
+    double integer = floor(magnitude);
+    limbs.back() = static_cast<uint32_t>(integer);
+    double fraction = magnitude - integer;
+    for (int i = static_cast<int>(limbs.size()) - 2; i >= 0 && fraction != 0; i--) {
+        fraction = ldexp(fraction, 32);
+        double limb = floor(fraction);
+        limbs[i] = static_cast<uint32_t>(limb);
+        fraction -= limb;
+    }
+}
+
+// Values below the range of double are converted a whole number of limbs higher up and
+// moved down afterwards. Bits that end up below the last limb are truncated.
+BigFixed::BigFixed(const FloatExp& value, int limbCount) {
+    int shift = value.exponent < 0 ? (31 - value.exponent) / 32 : 0;
+    BigFixed scaled(value.mantissa * FloatExp::power(min(value.exponent + 32 * shift, 1023)), limbCount);
+    this->limbs.assign(scaled.limbs.size(), 0);
+    this->negative = scaled.negative;
+    if (shift < getLimbs())
+        copy(scaled.limbs.begin() + shift, scaled.limbs.end(), limbs.begin());
+    if (isZero())
+        negative = false;
+}
+
+// Reads a plain decimal number like "-0.7436438870371587047521915061147". Digits beyond the
+// limbs are truncated. Returns false if the text is no such number or its integer part doesn't
+// fit into a limb.
+bool BigFixed::parse(const string& text, int limbCount, BigFixed& result) {
+    size_t start = 0;
+    bool is_negative = false;
+    if (!text.empty() && (text[0] == '-' || text[0] == '+')) {
+        is_negative = text[0] == '-';
+        start = 1;
+    }
+    const size_t point = text.find('.', start);
+    const string integer_digits = text.substr(start, point == string::npos ? string::npos : point - start);
+    const string fraction_digits = point == string::npos ? string() : text.substr(point + 1);
+    if (integer_digits.empty() && fraction_digits.empty())
+        return false;
+    uint64_t integer = 0;
+    for (char digit : integer_digits) {
+        if (digit < '0' || digit > '9')
+            return false;
+        integer = integer * 10 + (digit - '0');
+        if (integer > UINT32_MAX)
+            return false;
+    }
+    BigFixed value(0.0, limbCount);
+    // The fraction is built from its last digit up, value = (value + digit) / 10.
+    for (auto it = fraction_digits.rbegin(); it != fraction_digits.rend(); ++it) {
+        if (*it < '0' || *it > '9')
+            return false;
+        value.limbs.back() += *it - '0';
+        uint64_t remainder = 0;
+        for (int i = value.getLimbs() - 1; i >= 0; i--) {
+            uint64_t current = (remainder << 32) | value.limbs[i];
+            value.limbs[i] = static_cast<uint32_t>(current / 10);
+            remainder = current % 10;
+        }
+    }
+    value.limbs.back() = static_cast<uint32_t>(integer);
+    value.negative = is_negative && !value.isZero();
+    result = value;
+    return true;
+}
+
+// Limbs needed to resolve a view of this size, with guard bits for the pixels and the rounding
+// of the iterations.
+int BigFixed::limbsForScale(const FloatExp& scale) {
+    int bits = max(0, -scale.exponent) + guard_bits;
+    return 1 + (bits + 31) / 32;
+}
+
+int BigFixed::getLimbs() const {
+    return static_cast<int>(limbs.size());
+}
+
+// Changes the precision. Added limbs are zero, removed ones are truncated.
+void BigFixed::setLimbs(int count) {
+    count = max(count, 2);
+    int size = getLimbs();
+    if (count > size)
+        limbs.insert(limbs.begin(), count - size, 0);
+    else if (count < size)
+        limbs.erase(limbs.begin(), limbs.begin() + (size - count));
+    if (isZero())
+        negative = false;
+}
+
+// Rounds toward zero, only the three limbs from the highest set one contribute.
+double BigFixed::toDouble() const {
+    int size = getLimbs();
+    int top = size - 1;
+    while (top > 0 && limbs[top] == 0)
+        top--;
+    double result = 0;
+    for (int i = max(top - 2, 0); i <= top; i++)
+        result += ldexp(static_cast<double>(limbs[i]), 32 * (i - size + 1));
+    return negative ? -result : result;
+}
+
+// Same as toDouble() for values too small for double.
+FloatExp BigFixed::toFloatExp() const {
+    int size = getLimbs();
+    int top = size - 1;
+    while (top > 0 && limbs[top] == 0)
+        top--;
+    FloatExp result;
+    for (int i = max(top - 2, 0); i <= top; i++)
+        result = result + FloatExp(static_cast<double>(limbs[i]), 32 * (i - size + 1));
+    return negative ? -result : result;
+}
+
+bool BigFixed::isZero() const {
+    for (uint32_t limb : limbs) {
+        if (limb != 0)
+            return false;
+    }
+    return true;
+}
+
+BigFixed BigFixed::widened(int count) const {
+    BigFixed result = *this;
+    if (count > result.getLimbs())
+        result.setLimbs(count);
+    return result;
+}
+
+// Both operands must have the same number of limbs.
+int BigFixed::compareMagnitude(const BigFixed& a, const BigFixed& b) {
+    for (int i = a.getLimbs() - 1; i >= 0; i--) {
+        if (a.limbs[i] != b.limbs[i])
+            return a.limbs[i] < b.limbs[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+BigFixed BigFixed::addMagnitude(const BigFixed& a, const BigFixed& b, bool negative) {
+    BigFixed result = a;
+    result.negative = negative;
+    uint64_t carry = 0;
+    for (int i = 0; i < a.getLimbs(); i++) {
+        uint64_t sum = static_cast<uint64_t>(a.limbs[i]) + b.limbs[i] + carry;
+        result.limbs[i] = static_cast<uint32_t>(sum);
+        carry = sum >> 32;
+    }
+    return result;
+}
+
+// Requires |a| >= |b|.
+BigFixed BigFixed::subtractMagnitude(const BigFixed& a, const BigFixed& b, bool negative) {
+    BigFixed result = a;
+    result.negative = negative;
+    int64_t borrow = 0;
+    for (int i = 0; i < a.getLimbs(); i++) {
+        int64_t difference = static_cast<int64_t>(a.limbs[i]) - b.limbs[i] - borrow;
+        borrow = difference < 0;
+        result.limbs[i] = static_cast<uint32_t>(difference + (borrow << 32));
+    }
+    if (result.isZero())
+        result.negative = false;
+    return result;
+}
+
+BigFixed BigFixed::operator-() const {
+    BigFixed result = *this;
+    if (!isZero())
+        result.negative = !negative;
+    return result;
+}
+
+BigFixed operator+(const BigFixed& a, const BigFixed& b) {
+    int count = max(a.getLimbs(), b.getLimbs());
+    BigFixed x = a.widened(count);
+    BigFixed y = b.widened(count);
+    if (x.negative == y.negative)
+        return BigFixed::addMagnitude(x, y, x.negative);
+    if (BigFixed::compareMagnitude(x, y) >= 0)
+        return BigFixed::subtractMagnitude(x, y, x.negative);
+    return BigFixed::subtractMagnitude(y, x, y.negative);
+}
+
+BigFixed operator-(const BigFixed& a, const BigFixed& b) {
+    return a + -b;
+}
+
+// Schoolbook multiplication. The fraction limbs below the precision are dropped.
+BigFixed operator*(const BigFixed& a, const BigFixed& b) {
+    int count = max(a.getLimbs(), b.getLimbs());
+    BigFixed x = a.widened(count);
+    BigFixed y = b.widened(count);
+    vector<uint32_t> product(2 * count, 0);
+    for (int i = 0; i < count; i++) {
+        if (x.limbs[i] == 0)
+            continue;
+        uint64_t carry = 0;
+        for (int j = 0; j < count; j++) {
+            uint64_t term = static_cast<uint64_t>(x.limbs[i]) * y.limbs[j] + product[i + j] + carry;
+            product[i + j] = static_cast<uint32_t>(term);
+            carry = term >> 32;
+        }
+        product[i + count] = static_cast<uint32_t>(carry);
+    }
+    BigFixed result = x;
+    copy(product.begin() + (count - 1), product.begin() + (2 * count - 1), result.limbs.begin());
+    result.negative = x.negative != y.negative && !result.isZero();
+    return result;
+}
+
+BigFixed abs(const BigFixed& a) {
+    BigFixed result = a;
+    result.negative = false;
+    return result;
+}
+
+bool operator==(const BigFixed& a, const BigFixed& b) {
+    int count = max(a.getLimbs(), b.getLimbs());
+    BigFixed x = a.widened(count);
+    BigFixed y = b.widened(count);
+    return x.negative == y.negative && BigFixed::compareMagnitude(x, y) == 0;
+}
+
+bool operator!=(const BigFixed& a, const BigFixed& b) {
+    return !(a == b);
+}
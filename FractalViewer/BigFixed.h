@@ -0,0 +1,45 @@
+#ifndef FRACTALVIEWER_BIGFIXED_H
+#define FRACTALVIEWER_BIGFIXED_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "FloatExp.h"
+using namespace std;
+
+// Signed fixed point number with a 32 bit integer part and a variable number of 32 bit
+// fraction limbs. Results are truncated, so the same inputs always give the same bits.
+// Operands of different precision are widened to the larger one.
+class BigFixed {
+    // Magnitude, least significant limb first. The last limb is the integer part.
+    vector<uint32_t> limbs;
+    bool negative;
+    static const int guard_bits = 64;
+    static int compareMagnitude(const BigFixed& a, const BigFixed& b);
+    static BigFixed addMagnitude(const BigFixed& a, const BigFixed& b, bool negative);
+    static BigFixed subtractMagnitude(const BigFixed& a, const BigFixed& b, bool negative);
+    bool isZero() const;
+    BigFixed widened(int count) const;
+
+public:
+    // Enough limbs to hold every double exactly, down to the smallest subnormal.
+    static const int exact_double_limbs = 35;
+    BigFixed();
+    explicit BigFixed(double value, int limbCount = 4);
+    BigFixed(const FloatExp& value, int limbCount);
+    static int limbsForScale(const FloatExp& scale);
+    static bool parse(const string& text, int limbCount, BigFixed& result);
+    int getLimbs() const;
+    void setLimbs(int count);
+    double toDouble() const;
+    FloatExp toFloatExp() const;
+    BigFixed operator-() const;
+    friend BigFixed operator+(const BigFixed& a, const BigFixed& b);
+    friend BigFixed operator-(const BigFixed& a, const BigFixed& b);
+    friend BigFixed operator*(const BigFixed& a, const BigFixed& b);
+    friend BigFixed abs(const BigFixed& a);
+    friend bool operator==(const BigFixed& a, const BigFixed& b);
+    friend bool operator!=(const BigFixed& a, const BigFixed& b);
+};
+
+#endif //FRACTALVIEWER_BIGFIXED_H
@@ -0,0 +1,86 @@
+#ifndef FRACTALVIEWER_DOUBLEDOUBLE_H
+#define FRACTALVIEWER_DOUBLEDOUBLE_H
+
+#include <cmath>
+
+// Negates value where sign is negative. The SIMD vector types bring their own overload.
+inline double flipSign(double value, double sign) {
+    return sign < 0 ? -value : value;
+}
+
+// Unevaluated sum hi + lo with |lo| below half an ulp of hi, about 106 bits of mantissa.
+// T is double or one of the SIMD vector types, so the formulas run on it unchanged.
+// Products are split with Dekker's method instead of FMA, so every instruction set
+// produces the same bits.
+template<class T>
+struct DoubleDouble {
+    T hi;
+    T lo;
+
+    explicit DoubleDouble(double value) : hi(value), lo(0.0) {}
+    DoubleDouble(const T& hi, const T& lo) : hi(hi), lo(lo) {}
+};
+
+// a + b for |a| >= |b|.
+template<class T>
+inline DoubleDouble<T> quickTwoSum(const T& a, const T& b) {
+    T sum = a + b;
+    return DoubleDouble<T>(sum, b - (sum - a));
+}
+
+template<class T>
+inline DoubleDouble<T> twoSum(const T& a, const T& b) {
+    T sum = a + b;
+    T b_part = sum - a;
+    return DoubleDouble<T>(sum, (a - (sum - b_part)) + (b - b_part));
+}
+
+template<class T>
+inline DoubleDouble<T> twoDifference(const T& a, const T& b) {
+    T difference = a - b;
+    T b_part = difference - a;
+    return DoubleDouble<T>(difference, (a - (difference - b_part)) - (b + b_part));
+}
+
+template<class T>
+inline DoubleDouble<T> twoProduct(const T& a, const T& b) {
+    const T splitter(134217729.0);
+    T t = splitter * a;
+    T a_hi = t - (t - a);
+    T a_lo = a - a_hi;
+    t = splitter * b;
+    T b_hi = t - (t - b);
+    T b_lo = b - b_hi;
+    T product = a * b;
+    return DoubleDouble<T>(product, ((a_hi * b_hi - product) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo);
+}
+
+template<class T>
+inline DoubleDouble<T> operator+(const DoubleDouble<T>& a, const DoubleDouble<T>& b) {
+    DoubleDouble<T> high = twoSum(a.hi, b.hi);
+    DoubleDouble<T> low = twoSum(a.lo, b.lo);
+    DoubleDouble<T> result = quickTwoSum(high.hi, high.lo + low.hi);
+    return quickTwoSum(result.hi, result.lo + low.lo);
+}
+
+template<class T>
+inline DoubleDouble<T> operator-(const DoubleDouble<T>& a, const DoubleDouble<T>& b) {
+    DoubleDouble<T> high = twoDifference(a.hi, b.hi);
+    DoubleDouble<T> low = twoDifference(a.lo, b.lo);
+    DoubleDouble<T> result = quickTwoSum(high.hi, high.lo + low.hi);
+    return quickTwoSum(result.hi, result.lo + low.lo);
+}
+
+template<class T>
+inline DoubleDouble<T> operator*(const DoubleDouble<T>& a, const DoubleDouble<T>& b) {
+    DoubleDouble<T> product = twoProduct(a.hi, b.hi);
+    return quickTwoSum(product.hi, product.lo + (a.hi * b.lo + a.lo * b.hi));
+}
+
+template<class T>
+inline DoubleDouble<T> abs(const DoubleDouble<T>& a) {
+    using std::abs;
+    return DoubleDouble<T>(abs(a.hi), flipSign(a.lo, a.hi));
+}
+
+#endif //FRACTALVIEWER_DOUBLEDOUBLE_H
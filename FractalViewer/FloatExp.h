@@ -0,0 +1,110 @@
+#ifndef FRACTALVIEWER_FLOATEXP_H
+#define FRACTALVIEWER_FLOATEXP_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Double mantissa with a separate exponent, value = mantissa * 2^exponent. Keeps 53 bits of
+// precision far below 1e-308, where double itself underflows. The mantissa is kept in
+// [1, 2) and the exponent is read and reset with integer operations instead of frexp() and
+// ldexp(), which is cheaper than the library calls. Only the scalar perturbation kernels
+// use it, there is no vectorized version.
+// Zero has a zero mantissa and an exponent below every other value.
+struct FloatExp {
+    double mantissa;
+    int exponent;
+
+    static const int zero_exponent = -0x20000000;
+
+    FloatExp() : mantissa(0), exponent(zero_exponent) {}
+    explicit FloatExp(double value) : mantissa(value), exponent(0) { normalize(); }
+    FloatExp(double mantissa, int exponent) : mantissa(mantissa), exponent(exponent) { normalize(); }
+
+    // Moves the binary exponent of the mantissa into exponent. Expects a normal or zero mantissa.
+    void normalize() {
+        uint64_t bits;
+        memcpy(&bits, &mantissa, sizeof(bits));
+        int biased = static_cast<int>((bits >> 52) & 0x7ff);
+        if (biased == 0) {
+            mantissa = 0;
+            exponent = zero_exponent;
+            return;
+        }
+        bits = (bits & ~(0x7ffULL << 52)) | (1023ULL << 52);
+        memcpy(&mantissa, &bits, sizeof(bits));
+        exponent += biased - 1023;
+    }
+
+    // 2^exponent for exponents within the range of normal doubles.
+    static double power(int exponent) {
+        uint64_t bits = static_cast<uint64_t>(exponent + 1023) << 52;
+        double result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+    // Flushes to zero below the normal range of double.
+    double toDouble() const {
+        if (exponent < -1022)
+            return 0;
+        if (exponent > 1023)
+            return mantissa * HUGE_VAL;
+        return mantissa * power(exponent);
+    }
+};
+
+inline FloatExp operator-(const FloatExp& a) {
+    FloatExp result = a;
+    result.mantissa = -a.mantissa;
+    return result;
+}
+
+// Aligns the smaller operand to the exponent of the larger one. Beyond 64 bits it doesn't
+// change the sum anymore.
+inline FloatExp operator+(const FloatExp& a, const FloatExp& b) {
+    const int difference = a.exponent - b.exponent;
+    if (difference > 64)
+        return a;
+    if (difference < -64)
+        return b;
+    if (difference >= 0)
+        return FloatExp(a.mantissa + b.mantissa * FloatExp::power(-difference), a.exponent);
+    return FloatExp(a.mantissa * FloatExp::power(difference) + b.mantissa, b.exponent);
+}
+
+inline FloatExp operator-(const FloatExp& a, const FloatExp& b) { return a + -b; }
+inline FloatExp operator*(const FloatExp& a, const FloatExp& b) {
+    return FloatExp(a.mantissa * b.mantissa, a.exponent + b.exponent);
+}
+inline FloatExp operator/(const FloatExp& a, const FloatExp& b) {
+    return FloatExp(a.mantissa / b.mantissa, a.exponent - b.exponent);
+}
+inline FloatExp operator*(const FloatExp& a, double b) { return a * FloatExp(b); }
+inline FloatExp operator/(const FloatExp& a, double b) { return a / FloatExp(b); }
+
+inline bool operator<(const FloatExp& a, const FloatExp& b) { return (a - b).mantissa < 0; }
+inline bool operator>(const FloatExp& a, const FloatExp& b) { return (a - b).mantissa > 0; }
+inline bool operator<=(const FloatExp& a, const FloatExp& b) { return (a - b).mantissa <= 0; }
+inline bool operator>=(const FloatExp& a, const FloatExp& b) { return (a - b).mantissa >= 0; }
+inline bool operator==(const FloatExp& a, const FloatExp& b) {
+    return a.mantissa == b.mantissa && a.exponent == b.exponent;
+}
+inline bool operator!=(const FloatExp& a, const FloatExp& b) { return !(a == b); }
+
+inline FloatExp abs(const FloatExp& a) {
+    FloatExp result = a;
+    result.mantissa = std::abs(a.mantissa);
+    return result;
+}
+
+inline FloatExp sqrt(const FloatExp& a) {
+    const int odd = a.exponent & 1;
+    return FloatExp(std::sqrt(a.mantissa * (1 + odd)), (a.exponent - odd) / 2);
+}
+
+inline double log10(const FloatExp& a) {
+    return std::log10(a.mantissa) + a.exponent * 0.30102999566398120;
+}
+
+#endif //FRACTALVIEWER_FLOATEXP_H
@@ -0,0 +1,108 @@
+#ifndef FRACTALVIEWER_FORMULAS_H
+#define FRACTALVIEWER_FORMULAS_H
+
+#include <cmath>
+
+// One policy per fractal formula. step() advances z by one iteration and is written
+// once for double and for the SIMD vector types, which provide +, -, * and abs().
+// The kernels are instantiated per formula so the hot loop contains no switch.
+// factor is 2 * sin(t) and only used by the animation, the other formulas leave it unnamed.
+// periodic formulas have attracting cycles inside the set, so the kernels check for them.
+// cardioid formulas are the plain Mandelbrot set, whose main cardioid and period-2 bulb
+// are rejected in closed form before iterating.
+// perturbedStep() advances the offset d of a pixel from the reference orbit point z:
+// d is replaced by f(z + d, c + dc) - f(z, c), written so the large terms cancel exactly.
+
+// |c + d| - |c| without cancellation when c is large and d is small.
+template<class T>
+inline T diffAbs(const T& c, const T& d) {
+    const T zero(0.0);
+    if (c >= zero)
+        return c + d >= zero ? d : -(T(2.0) * c + d);
+    return c + d > zero ? T(2.0) * c + d : -d;
+}
+
+struct MandelbrotFormula {
+    static const bool vectorizable = true;
+    static const bool periodic = true;
+    static const bool cardioid = true;
+    template<class T>
+    static inline void step(T& re, T& im, const T& x0, const T& y0, const T&) {
+        T tmp = re * re - im * im + x0;
+        im = T(2.0) * re * im + y0;
+        re = tmp;
+    }
+    template<class T>
+    static inline void perturbedStep(const T& z_re, const T& z_im, T& d_re, T& d_im, const T& dc_re, const T& dc_im) {
+        T a = T(2.0) * z_re + d_re;
+        T b = T(2.0) * z_im + d_im;
+        T tmp = a * d_re - b * d_im + dc_re;
+        d_im = a * d_im + b * d_re + dc_im;
+        d_re = tmp;
+    }
+};
+
+struct TricornFormula {
+    static const bool vectorizable = true;
+    static const bool periodic = true;
+    static const bool cardioid = false;
+    template<class T>
+    static inline void step(T& re, T& im, const T& x0, const T& y0, const T&) {
+        T tmp = re * re - im * im + x0;
+        im = T(-2.0) * re * im + y0;
+        re = tmp;
+    }
+    template<class T>
+    static inline void perturbedStep(const T& z_re, const T& z_im, T& d_re, T& d_im, const T& dc_re, const T& dc_im) {
+        T a = T(2.0) * z_re + d_re;
+        T b = T(2.0) * z_im + d_im;
+        T tmp = a * d_re - b * d_im + dc_re;
+        d_im = dc_im - (a * d_im + b * d_re);
+        d_re = tmp;
+    }
+};
+
+struct MandelbrotTricornFormula {
+    static const bool vectorizable = true;
+    static const bool periodic = false;
+    static const bool cardioid = false;
+    template<class T>
+    static inline void step(T& re, T& im, const T& x0, const T& y0, const T& factor) {
+        T tmp = re * re - im * im + x0;
+        im = factor * re * im + y0;
+        re = tmp;
+    }
+};
+
+struct BurningShipFormula {
+    static const bool vectorizable = true;
+    static const bool periodic = true;
+    static const bool cardioid = false;
+    template<class T>
+    static inline void step(T& re, T& im, const T& x0, const T& y0, const T&) {
+        using std::abs;
+        T tmp = re * re - im * im + x0;
+        im = T(2.0) * abs(re * im) + y0;
+        re = tmp;
+    }
+    template<class T>
+    static inline void perturbedStep(const T& z_re, const T& z_im, T& d_re, T& d_im, const T& dc_re, const T& dc_im) {
+        T tmp = (T(2.0) * z_re + d_re) * d_re - (T(2.0) * z_im + d_im) * d_im + dc_re;
+        d_im = T(2.0) * diffAbs(z_re * z_im, z_re * d_im + d_re * z_im + d_re * d_im) + dc_im;
+        d_re = tmp;
+    }
+};
+
+// Uses cos and fmod, so it only exists for double.
+struct ExperimentFormula {
+    static const bool vectorizable = false;
+    static const bool periodic = false;
+    static const bool cardioid = false;
+    static inline void step(double& re, double& im, const double& x0, const double& y0, const double&) {
+        double tmp = re * re - im * im + cos(x0);
+        im = fmod(tmp * im,2) + cos(y0);
+        re = fmod(cos(tmp*re)*4,2);
+    }
+};
+
+#endif //FRACTALVIEWER_FORMULAS_H
@@ -1,12 +1,41 @@
 #include "Fractal.h"
+#include "Subdivision.h"
+#include <cstring>
 #include <iostream>
 
 
-Fractal::Fractal(Image* img, bool dynamicIterations, float escapeRadius) {
+Fractal::Fractal(PixelBuffer* img, bool dynamicIterations, float escapeRadius) {
     this->img = img;
     this->dynamic_iterations = dynamicIterations;
     this->max_iterations = 32;
     this->escape_radius = escapeRadius;
+    this->kernel_isa = detectKernelIsa();
+    this->view_version = 1;
+    this->palette_version = 1;
+    this->buffer_width = 0;
+    this->buffer_height = 0;
+    this->buffer_iterations = 0;
+    this->buffer_time = 0;
+    this->buffer_view_version = 0;
+    this->buffer_step = 0;
+    this->buffer_type = FractalTypes::mandelbrot;
+    this->buffer_render_method = RenderMethod::subdivision;
+    this->buffer_preview = false;
+    this->display_width = 0;
+    this->display_height = 0;
+    this->display_iterations = 0;
+    this->display_type = FractalTypes::mandelbrot;
+    this->display_view_version = 0;
+    this->lut_palette_version = 0;
+    this->progressive = false;
+    this->render_method = RenderMethod::subdivision;
+    this->image_palette_version = 0;
+    this->cancel_flag = nullptr;
+    this->pool = &ThreadPool::shared();
+    this->timed_tile_size = 0;
+    this->computed_iterations = 0;
+    // Default palette of the viewer, so frames rendered before setColors() have colors.
+    this->colors = {{0, 0, 0}, {0, 7, 100}, {32, 107, 203}, {237, 255, 255}, {255, 170, 0}, {0, 2, 0}};
     setFractalType(FractalTypes::mandelbrot);
 }
 
@@ -14,6 +43,8 @@ Fractal::~Fractal() {
 }
 
 void Fractal::setIterations(int amount) {
+    if (amount != this->max_iterations)
+        this->view_version++;
     this->max_iterations = amount;
 }
 
@@ -29,10 +60,34 @@ const char *Fractal::getName() {
     int item = (int)this->getFractalType();
     return this->FractalTypesNames[item-1];
 }
+
+// Perturbation only has a scalar kernel.
+const char *Fractal::getKernelName(int width) const {
+    KernelPrecision precision = selectPrecision(width);
+    if (precision == KernelPrecision::perturbation || precision == KernelPrecision::extended_perturbation)
+        return getKernelIsaName(KernelIsa::scalar);
+    return getKernelIsaName(this->kernel_isa);
+}
+
+const char *Fractal::getPrecisionName(int width) const {
+    switch (selectPrecision(width)) {
+        case KernelPrecision::single_precision:
+            return "Single";
+        case KernelPrecision::double_double:
+            return "Double-Double";
+        case KernelPrecision::perturbation:
+            return "Perturbation";
+        case KernelPrecision::extended_perturbation:
+            return "Perturbation (FloatExp)";
+        default:
+            return "Double";
+    }
+}
+
 // Set a new fractal and reset the view.
 void Fractal::setFractalType(FractalTypes newFracType)
 {
-    FractalSettings limits_frac = { 0,0,0,0,0,0 };
+    FractalSettings limits_frac = { 0,0,0,0,0,0,1 };
     switch (newFracType)
     {
         case FractalTypes::mandelbrot:
@@ -51,100 +106,616 @@ void Fractal::setFractalType(FractalTypes newFracType)
             limits_frac = { -2.5, 1.0, -1.0, 1.0 , 0, 0, 1.5 };
             break;
     }
+    this->view_version++;
     this->fractal_type = newFracType;
     this->max_iterations = 32;
-    this->current_frac_settings.min_real_x = limits_frac.min_real_x * limits_frac.scale + limits_frac.offset_re_x;
-    this->current_frac_settings.max_real_x = limits_frac.max_real_x * limits_frac.scale + limits_frac.offset_re_x;
-    this->current_frac_settings.min_im_y = limits_frac.min_im_y * limits_frac.scale + limits_frac.offset_im_y;
-    this->current_frac_settings.max_im_y = limits_frac.max_im_y * limits_frac.scale + limits_frac.offset_im_y;
+    this->center_re = BigFixed((limits_frac.min_real_x + limits_frac.max_real_x) / 2 * limits_frac.scale + limits_frac.offset_re_x);
+    this->center_im = BigFixed((limits_frac.min_im_y + limits_frac.max_im_y) / 2 * limits_frac.scale + limits_frac.offset_im_y);
+    this->range_re = FloatExp((limits_frac.max_real_x - limits_frac.min_real_x) * limits_frac.scale);
+    this->range_im = FloatExp((limits_frac.max_im_y - limits_frac.min_im_y) * limits_frac.scale);
+    updatePrecision();
 }
 
 // Interpolates two colors.
-Color Fractal::linearInterpolation(const Color& col1, const Color& col2, double t)
+PaletteColor Fractal::linearInterpolation(const PaletteColor& col1, const PaletteColor& col2, double t)
 {
     auto const b = 1 - t;
-    return {static_cast<Uint8>((b * col1.r + t * col2.r)),
-            static_cast<Uint8>((b * col1.g + t * col2.g)),
-            static_cast<Uint8>((b * col1.b + t * col2.b))};
+    return {static_cast<uint8_t>((b * col1.r + t * col2.r)),
+            static_cast<uint8_t>((b * col1.g + t * col2.g)),
+            static_cast<uint8_t>((b * col1.b + t * col2.b))};
 }
 
 void Fractal::toggleIterationMode() {
+    this->view_version++;
     this->dynamic_iterations = !this->dynamic_iterations;
     this->max_iterations = 32;
 }
 
+bool Fractal::isAnimated() const {
+    return this->fractal_type == FractalTypes::mandelbrot_tricorn_animation;
+}
+
+// The view rounded to double. Deep zooms need moveView() and zoomView() to keep their precision.
 FractalSettings Fractal::getFracSettings() const {
-    return this->current_frac_settings;
+    FractalSettings settings = { 0, 0, 0, 0, 0, 0, 1 };
+    settings.min_real_x = (center_re - BigFixed(range_re / 2, center_re.getLimbs())).toDouble();
+    settings.max_real_x = (center_re + BigFixed(range_re / 2, center_re.getLimbs())).toDouble();
+    settings.min_im_y = (center_im - BigFixed(range_im / 2, center_im.getLimbs())).toDouble();
+    settings.max_im_y = (center_im + BigFixed(range_im / 2, center_im.getLimbs())).toDouble();
+    return settings;
 }
 
 void Fractal::setFracSettings(FractalSettings newSettings) {
-    this->current_frac_settings = newSettings;
+    const int limbs = BigFixed::exact_double_limbs;
+    BigFixed new_center_re = BigFixed(newSettings.min_real_x, limbs) + BigFixed(newSettings.max_real_x, limbs);
+    BigFixed new_center_im = BigFixed(newSettings.min_im_y, limbs) + BigFixed(newSettings.max_im_y, limbs);
+    new_center_re = new_center_re * BigFixed(0.5);
+    new_center_im = new_center_im * BigFixed(0.5);
+    FloatExp new_range_re(newSettings.max_real_x - newSettings.min_real_x);
+    FloatExp new_range_im(newSettings.max_im_y - newSettings.min_im_y);
+    if (new_center_re != center_re || new_center_im != center_im ||
+        new_range_re != range_re || new_range_im != range_im)
+        this->view_version++;
+    this->center_re = new_center_re;
+    this->center_im = new_center_im;
+    this->range_re = new_range_re;
+    this->range_im = new_range_im;
+    updatePrecision();
+}
+
+// Sets the view at full precision, for views deeper than setFracSettings() can describe.
+void Fractal::setView(const BigFixed& centerRe, const BigFixed& centerIm, const FloatExp& rangeRe, const FloatExp& rangeIm) {
+    if (centerRe != center_re || centerIm != center_im || rangeRe != range_re || rangeIm != range_im)
+        this->view_version++;
+    this->center_re = centerRe;
+    this->center_im = centerIm;
+    this->range_re = rangeRe;
+    this->range_im = rangeIm;
+    updatePrecision();
+}
+
+// Sizes the center for the current extent. Zooming out drops the bits that no longer matter,
+// which keeps the reference orbit cheap.
+void Fractal::updatePrecision() {
+    int limbs = BigFixed::limbsForScale(min(range_re, range_im));
+    center_re.setLimbs(limbs);
+    center_im.setLimbs(limbs);
+}
+
+// Moves the view by a fraction of its width and height.
+void Fractal::moveView(double x, double y) {
+    if (x == 0 && y == 0)
+        return;
+    this->view_version++;
+    this->center_re = center_re + BigFixed(range_re * x, center_re.getLimbs());
+    this->center_im = center_im + BigFixed(range_im * y, center_im.getLimbs());
+}
+
+// Centers the view on a point given as a fraction of the view, (0.5, 0.5) being the current
+// center, and shrinks it by factor.
+void Fractal::zoomView(double x, double y, double factor) {
+    this->view_version++;
+    FloatExp offset_re = range_re * (x - 0.5);
+    FloatExp offset_im = range_im * (y - 0.5);
+    this->range_re = range_re / factor;
+    this->range_im = range_im / factor;
+    updatePrecision();
+    this->center_re = center_re + BigFixed(offset_re, center_re.getLimbs());
+    this->center_im = center_im + BigFixed(offset_im, center_im.getLimbs());
+}
+
+// Empty palettes are ignored, coloring needs at least one color.
+void Fractal::setColors(const vector<PaletteColor>& newColors) {
+    if (newColors.empty())
+        return;
+    if (newColors != this->colors)
+        this->palette_version++;
+    this->colors = newColors;
 }
 
-void Fractal::setImage(Image* newImage)
+void Fractal::setImage(PixelBuffer* newImage)
 {
     this->img = newImage;
+    this->image_palette_version = 0;
+}
+
+// Rendering stops early once the flag is set. The frame is then left unfinished.
+void Fractal::setCancelFlag(const atomic<bool>* flag) {
+    this->cancel_flag = flag;
+}
+
+// Renders on other threads than the shared pool, like a pool of fewer threads to measure scaling.
+void Fractal::setThreadPool(ThreadPool* newPool) {
+    this->pool = newPool;
+}
+
+// Takes over the view and palette of another fractal but keeps this one's buffers.
+// The versions are copied as well, so the buffers are only recomputed if the view differs.
+void Fractal::syncView(const Fractal& view) {
+    this->fractal_type = view.fractal_type;
+    this->center_re = view.center_re;
+    this->center_im = view.center_im;
+    this->range_re = view.range_re;
+    this->range_im = view.range_im;
+    this->dynamic_iterations = view.dynamic_iterations;
+    // Dynamic limits follow the size of the frame the view never rendered, its own is stale.
+    if (!view.dynamic_iterations)
+        this->max_iterations = view.max_iterations;
+    this->render_method = view.render_method;
+    this->colors = view.colors;
+    this->view_version = view.view_version;
+    this->palette_version = view.palette_version;
+}
+
+// Subdivision skips the inside of regions with the same iteration count. Per pixel
+// rendering computes every pixel and is kept to validate the subdivision against.
+void Fractal::setRenderMethod(RenderMethod method) {
+    if (method != this->render_method)
+        this->view_version++;
+    this->render_method = method;
+}
+
+RenderMethod Fractal::getRenderMethod() const {
+    return this->render_method;
+}
+
+// Row major tiles of getTileSize() pixels, covering the frame of the last pass.
+const vector<float>& Fractal::getTileTimes() const {
+    return this->tile_times;
+}
+
+int Fractal::getTileSize() const {
+    return this->timed_tile_size;
+}
+
+// Iteration count behind every pixel of the image, row major. Pixels filled by subdivision
+// count with the iterations of the border they were filled from.
+const vector<int>& Fractal::getIterationCounts() const {
+    return this->display_buffer;
+}
+
+// Iterations the kernels actually ran for the current image, summed over its passes. Unlike
+// the counts above it leaves out pixels that were filled or decided without iterating.
+int64_t Fractal::getComputedIterations() const {
+    return this->computed_iterations;
+}
+
+// Filling is only safe for connected sets, where a region enclosed by one count has no holes.
+bool Fractal::usesSubdivision() const {
+    return this->render_method == RenderMethod::subdivision &&
+           (this->fractal_type == FractalTypes::mandelbrot || this->fractal_type == FractalTypes::tricorn);
 }
 
-// Renders The Fractal Using OpenMp
-void Fractal::renderFractal(vector<Color> colors, int width, int height, double time_delta) {
-    if (this->dynamic_iterations) {
-        this->max_iterations = static_cast<int>(50 * pow((log10(width / (current_frac_settings.max_im_y - current_frac_settings.min_im_y))), 1.25));
+// Progressive frames start at 1/8 resolution and are refined over three more passes.
+void Fractal::setProgressive(bool enabled) {
+    this->progressive = enabled;
+}
+
+// Deeper views need more precise arithmetic, shallow ones get by with float. Perturbation
+// iterates relative to the orbit of the center, formulas without the precision needed fall
+// back to the next cheaper one.
+KernelPrecision Fractal::selectPrecision(int width) const {
+    const FloatExp extended_spacing = range_re / width;
+    if (extended_spacing < FloatExp(perturbation_spacing) &&
+        selectSpanKernel(fractal_type, KernelIsa::scalar, KernelPrecision::perturbation) != nullptr) {
+        if (extended_spacing < FloatExp(extended_perturbation_spacing))
+            return KernelPrecision::extended_perturbation;
+        return KernelPrecision::perturbation;
     }
-#pragma omp parallel for
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            double x0 = current_frac_settings.min_real_x + (current_frac_settings.max_real_x - current_frac_settings.min_real_x) * x / width;
-            double y0 = current_frac_settings.min_im_y + (current_frac_settings.max_im_y - current_frac_settings.min_im_y) * y / height;
-            double re = 0, im = 0, tmp;
-            int current_iteration = 0;
-            for (current_iteration; current_iteration < this->max_iterations; current_iteration++) {
-                switch (fractal_type)
-                {
-                    case FractalTypes::mandelbrot:
-                        tmp = re * re - im * im + x0;
-                        im = 2.0 * re * im + y0;
-                        re = tmp;
-                        break;
-                    case FractalTypes::tricorn:
-                        tmp = re * re - im * im + x0;
-                        im = -2 * re * im + y0;
-                        re = tmp;
-                        break;
-                    case FractalTypes::mandelbrot_tricorn_animation:
-                        tmp = re * re - im * im + x0;
-                        im = 2.0 * sin(time_delta) * re * im + y0;
-                        re = tmp;
-                        break;
-                    case FractalTypes::burning_ship:
-                        tmp = re * re - im * im + x0;
-                        im = 2.0 * std::abs(re * im) + y0;
-                        re = tmp;
-                        break;
-                    case FractalTypes::experiment:
-                        tmp = re * re - im * im + cos(x0);
-                        im = fmod(tmp * im,2) + cos(y0);
-                        re = fmod(cos(tmp*re)*4,2);
-                        break;
-                }
-                if (re * re + im * im > 4) {
-                    break;
-                }
+    const double spacing = extended_spacing.toDouble();
+    if (spacing < double_double_spacing &&
+        selectSpanKernel(fractal_type, KernelIsa::scalar, KernelPrecision::double_double) != nullptr)
+        return KernelPrecision::double_double;
+    // Floats count iterations exactly up to 2^24.
+    if (spacing >= single_precision_spacing && max_iterations <= (1 << 24) &&
+        selectSpanKernel(fractal_type, KernelIsa::scalar, KernelPrecision::single_precision) != nullptr)
+        return KernelPrecision::single_precision;
+    return KernelPrecision::double_precision;
+}
+
+unsigned long Fractal::getViewVersion() const {
+    return this->view_version;
+}
+
+unsigned long Fractal::getPaletteVersion() const {
+    return this->palette_version;
+}
+
+// Iterations used for a frame of this width. Dynamic iterations grow with the zoom.
+int Fractal::computeIterations(int width) const {
+    if (!this->dynamic_iterations)
+        return this->max_iterations;
+    return static_cast<int>(50 * pow(log10(static_cast<double>(width)) - log10(range_im), 1.25));
+}
+
+// Checks whether the iteration buffer belongs to another view. Time only matters for the animation.
+bool Fractal::isBufferStale(int width, int height, double time_delta) const {
+    if (width != buffer_width || height != buffer_height || view_version != buffer_view_version)
+        return true;
+    if (computeIterations(width) != buffer_iterations)
+        return true;
+    return isAnimated() && time_delta != buffer_time;
+}
+
+// Checks whether the iteration buffer is out of date or still missing progressive passes.
+bool Fractal::needsIteration(int width, int height, double time_delta) const {
+    return isBufferStale(width, height, time_delta) || buffer_step != 1;
+}
+
+// Whether renderFractal would change the image.
+bool Fractal::needsRender(int width, int height, double time_delta) const {
+    return needsIteration(width, height, time_delta) || palette_version != image_palette_version;
+}
+
+// Estimated cost of every tile, only the order matters. Refining passes sum the iterations the
+// previous pass found in the tile. New views reuse the times of the last frame's tiles, which
+// mostly show the same regions after a small zoom or move. Without either the tiles are equal.
+vector<float> Fractal::estimateTileCosts(int width, int height, int tile_size, int step, bool refine) const {
+    const int tiles_x = (width + tile_size - 1) / tile_size;
+    const int tiles = tiles_x * ((height + tile_size - 1) / tile_size);
+    if (!refine)
+        return tile_times.size() == static_cast<size_t>(tiles) && timed_tile_size == tile_size ?
+               tile_times : vector<float>(tiles, 0);
+    vector<float> costs(tiles, 0);
+    const int coarse = step * 2;
+    for (int y = 0; y < height; y += coarse) {
+        const int* row = &iteration_buffer[static_cast<size_t>(y) * width];
+        float* tile_row = &costs[static_cast<size_t>(y / tile_size) * tiles_x];
+        for (int x = 0; x < width; x += coarse)
+            tile_row[x / tile_size] += row[x];
+    }
+    return costs;
+}
+
+// Fills in the view of a frame and returns the kernel for its fractal type and precision.
+SpanKernel Fractal::prepareKernel(int width, int height, double time_delta, KernelParams& params) const {
+    // The corner of the view is split into a double and the remainder for the double-double kernels.
+    BigFixed min_re = center_re - BigFixed(range_re / 2, center_re.getLimbs());
+    BigFixed min_im = center_im - BigFixed(range_im / 2, center_im.getLimbs());
+    params.min_real_x = min_re.toDouble();
+    params.min_real_x_lo = (min_re - BigFixed(params.min_real_x, min_re.getLimbs())).toDouble();
+    params.range_real_x = range_re.toDouble();
+    params.min_im_y = min_im.toDouble();
+    params.min_im_y_lo = (min_im - BigFixed(params.min_im_y, min_im.getLimbs())).toDouble();
+    params.range_im_y = range_im.toDouble();
+    params.width = width;
+    params.height = height;
+    params.max_iterations = this->max_iterations;
+    params.im_factor = 2.0 * sin(time_delta);
+    params.periodicity_tolerance = periodicity_tolerance * params.range_real_x / width;
+    // Resolved once per frame, the kernel is specialized for the fractal type and precision.
+    KernelPrecision precision = selectPrecision(width);
+    SpanKernel kernel = selectSpanKernel(fractal_type, this->kernel_isa, precision);
+    if (precision == KernelPrecision::perturbation || precision == KernelPrecision::extended_perturbation) {
+        // Pixels become offsets from the center, whose orbit was computed with the view.
+        // Past the range of double they are given in units of 2^offset_exponent.
+        params.offset_exponent = precision == KernelPrecision::extended_perturbation ? range_re.exponent : 0;
+        const FloatExp unit(1.0, params.offset_exponent);
+        params.range_real_x = (range_re / unit).toDouble();
+        params.range_im_y = (range_im / unit).toDouble();
+        params.min_real_x = -params.range_real_x / 2;
+        params.min_im_y = -params.range_im_y / 2;
+        params.reference = reference_orbit.get();
+        params.bla = bla_table.get();
+    }
+    return kernel;
+}
+
+// Moves the rows and columns of a buffer by a pan of shift pixels. Pixels that leave the frame
+// are dropped, the ones that come into view are left for the caller to compute.
+template<class T>
+static void shiftBuffer(vector<T>& buffer, int width, int height, int shift_x, int shift_y) {
+    const int x0 = max(0, -shift_x);
+    const int count = width - abs(shift_x);
+    for (int i = 0; i < height; i++) {
+        // Rows are moved in the order that reads every row before it is overwritten.
+        const int y = shift_y >= 0 ? i : height - 1 - i;
+        const int source = y + shift_y;
+        if (source < 0 || source >= height)
+            continue;
+        memmove(&buffer[static_cast<size_t>(y) * width + x0],
+                &buffer[static_cast<size_t>(source) * width + x0 + shift_x], count * sizeof(T));
+    }
+}
+
+// Checks whether the view is the one of the buffer moved by whole pixels, which have to leave
+// part of the buffer in view. Everything else about the view has to be the same.
+bool Fractal::findPanShift(int width, int height, int& shift_x, int& shift_y) const {
+    if (buffer_step != 1 || width != buffer_width || height != buffer_height || isAnimated() ||
+        max_iterations != buffer_iterations || fractal_type != buffer_type ||
+        render_method != buffer_render_method || range_re != buffer_range_re || range_im != buffer_range_im)
+        return false;
+    const double x = ((center_re - buffer_center_re).toFloatExp() / range_re).toDouble() * width;
+    const double y = ((center_im - buffer_center_im).toFloatExp() / range_im).toDouble() * height;
+    if (!(abs(x) < width && abs(y) < height))
+        return false;
+    shift_x = static_cast<int>(round(x));
+    shift_y = static_cast<int>(round(y));
+    return abs(x - shift_x) <= pan_tolerance && abs(y - shift_y) <= pan_tolerance;
+}
+
+// Reuses the last frame for a pan, only the rows and columns that came into view are computed.
+// They are computed at the exact view, the buffer stays on the pixel grid of the old one.
+// Returns false if the frame got cancelled, the buffer is invalid then.
+bool Fractal::iteratePan(int width, int height, double time_delta, int shift_x, int shift_y) {
+    KernelParams params{};
+    SpanKernel kernel = prepareKernel(width, height, time_delta, params);
+    shiftBuffer(iteration_buffer, width, height, shift_x, shift_y);
+    const atomic<bool>* cancel = this->cancel_flag;
+    atomic<int64_t> ran(0);
+    this->pool->parallelFor(height, [&](int y) {
+        if (cancel != nullptr && cancel->load(memory_order_relaxed))
+            return;
+        int x0 = 0;
+        int x1 = width;
+        // Rows that were in the old frame only miss the columns on the side the view moved to.
+        if (y + shift_y >= 0 && y + shift_y < height) {
+            if (shift_x >= 0)
+                x0 = width - shift_x;
+            else
+                x1 = -shift_x;
+        }
+        if (x0 >= x1)
+            return;
+        PixelSpan span = { x0, y, 1, 0, x1 - x0, 1 };
+        size_t offset = static_cast<size_t>(y) * width + x0;
+        ran.fetch_add(kernel(params, span, &iteration_buffer[offset]), memory_order_relaxed);
+    });
+    if (cancel != nullptr && cancel->load()) {
+        buffer_view_version = 0;
+        buffer_step = 0;
+        return false;
+    }
+
+    buffer_center_re = buffer_center_re + BigFixed(range_re * (static_cast<double>(shift_x) / width), center_re.getLimbs());
+    buffer_center_im = buffer_center_im + BigFixed(range_im * (static_cast<double>(shift_y) / height), center_im.getLimbs());
+    buffer_view_version = view_version;
+    computed_iterations += ran.load();
+    return true;
+}
+
+// Runs the escape time loop for every step-th pixel in both directions and stores the results
+// in the iteration buffer. Samples left over from the previous, twice as coarse pass are skipped.
+// Returns false if the frame got cancelled, the buffer is invalid then.
+bool Fractal::iterateFractal(int width, int height, double time_delta, int step) {
+    KernelParams params{};
+    SpanKernel kernel = prepareKernel(width, height, time_delta, params);
+    iteration_buffer.resize(static_cast<size_t>(width) * height);
+    const atomic<bool>* cancel = this->cancel_flag;
+    const bool refine = buffer_step == step * 2 && !buffer_preview;
+    const bool subdivide = step == 1 && usesSubdivision();
+    const int tile_size = subdivide ? subdivision_tile_size : render_tile_size;
+    const int tiles_x = (width + tile_size - 1) / tile_size;
+    vector<float> costs = estimateTileCosts(width, height, tile_size, step, refine);
+    SubdivisionContext context = { kernel, params, iteration_buffer.data(), refine };
+    atomic<int64_t> ran(0);
+    runTiles(*this->pool, costs, tile_times, cancel, [&](int tile) {
+        int x0 = (tile % tiles_x) * tile_size;
+        int y0 = (tile / tiles_x) * tile_size;
+        int x1 = min(x0 + tile_size, width);
+        int y1 = min(y0 + tile_size, height);
+        if (subdivide) {
+            ran.fetch_add(renderSubdivided(context, x0, y0, x1 - 1, y1 - 1), memory_order_relaxed);
+            return;
+        }
+        int64_t tile_ran = 0;
+        // Tiles are a multiple of every pass's step, so their samples line up with the passes.
+        for (int y = y0; y < y1; y += step) {
+            PixelSpan span = { x0, y, step, 0, (x1 - x0 + step - 1) / step, step };
+            if (refine && y % (step * 2) == 0) {
+                // Every other sample of this row was computed by the previous pass.
+                span.x = x0 + step;
+                span.dx = step * 2;
+                span.stride = step * 2;
+                span.count = (x1 - x0 + step - 1) / (step * 2);
             }
+            size_t offset = static_cast<size_t>(y) * width + span.x;
+            tile_ran += kernel(params, span, &iteration_buffer[offset]);
+        }
+        ran.fetch_add(tile_ran, memory_order_relaxed);
+    });
+    timed_tile_size = tile_size;
+    if (cancel != nullptr && cancel->load()) {
+        buffer_view_version = 0;
+        buffer_step = 0;
+        return false;
+    }
+
+    buffer_width = width;
+    buffer_height = height;
+    buffer_iterations = max_iterations;
+    buffer_time = time_delta;
+    buffer_view_version = view_version;
+    buffer_step = step;
+    buffer_preview = false;
+    buffer_type = fractal_type;
+    buffer_render_method = render_method;
+    buffer_center_re = center_re;
+    buffer_center_im = center_im;
+    buffer_range_re = range_re;
+    buffer_range_im = range_im;
+    computed_iterations += ran.load();
+    return true;
+}
+
+// Scales the image to the view as a preview, nearest sample per pixel. Pixels outside the
+// old image repeat its edge and count as missing. Returns the step of the first pass, coarse
+// enough for the most stretched pixels, or 0 if there is no image of the view to start from.
+int Fractal::reprojectDisplay(int width, int height) {
+    if (display_view_version == 0 || width != display_width || height != display_height ||
+        fractal_type != display_type || isAnimated())
+        return 0;
+    // Old pixel = scale * new pixel + offset in both directions.
+    const double scale = (range_re / display_range_re).toDouble();
+    if (!(scale > 1.0 / 64 && scale < 64))
+        return 0;
+    const double offset_x = ((center_re - display_center_re).toFloatExp() / display_range_re).toDouble() * width +
+                            width * (1 - scale) / 2;
+    const double offset_y = ((center_im - display_center_im).toFloatExp() / display_range_im).toDouble() * height +
+                            height * (1 - scale) / 2;
+    if (!(offset_x < width && offset_x + scale * width > 0 && offset_y < height && offset_y + scale * height > 0))
+        return 0;
 
-            // Coloring
-            // Has to be inside of this function because I can't figure out
-            // how to use OpenMp with external functions calls
-            if (current_iteration == this->max_iterations)
-                current_iteration = 0;
-            unsigned int max_color = colors.size() - 1;
-            auto color_value = (static_cast<double>(current_iteration) / this->max_iterations) * max_color;
-            auto i_col = static_cast<unsigned int>(color_value);
-            Color color1 = colors[i_col];
-            Color color2 = colors[min(i_col + 1, max_color)];
-            Color col = linearInterpolation(color1, color2, color_value - i_col);
-            this->img->setPixel(x, y, col);
+    vector<int> source_x(width);
+    vector<bool> inside_x(width);
+    for (int x = 0; x < width; x++) {
+        const double old_x = floor(scale * x + offset_x + 0.5);
+        inside_x[x] = old_x >= 0 && old_x < width;
+        source_x[x] = static_cast<int>(max(0.0, min(old_x, width - 1.0)));
+    }
+    vector<int> iterations(static_cast<size_t>(width) * height);
+    vector<float> stretch(static_cast<size_t>(width) * height);
+    const int old_max = display_iterations;
+    const int new_max = max_iterations;
+    this->pool->parallelFor(height, [&](int y) {
+        const double old_y = floor(scale * y + offset_y + 0.5);
+        const bool inside_y = old_y >= 0 && old_y < height;
+        const size_t source_row = static_cast<size_t>(max(0.0, min(old_y, height - 1.0))) * width;
+        const size_t row = static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; x++) {
+            int value = display_buffer[source_row + source_x[x]];
+            // Points inside the set stay inside when the iteration count changes with the zoom.
+            if (value >= old_max || value >= new_max)
+                value = new_max;
+            iterations[row + x] = value;
+            stretch[row + x] = inside_y && inside_x[x] ? display_stretch[source_row + source_x[x]] / static_cast<float>(scale) :
+                               INFINITY;
         }
+    });
+    float worst = 0;
+    for (float value : stretch)
+        worst = max(worst, value);
+    display_buffer.swap(iterations);
+    display_stretch.swap(stretch);
+    display_iterations = new_max;
+    display_center_re = center_re;
+    display_center_im = center_im;
+    display_range_re = range_re;
+    display_range_im = range_im;
+    display_view_version = view_version;
+    int step = 1;
+    while (step < 8 && step * 2 <= worst)
+        step *= 2;
+    return step;
+}
+
+// Takes the samples of the last pass into the image. Before the last pass every sample stands
+// for a step x step block, which only replaces preview pixels that are stretched even more.
+void Fractal::composeDisplay() {
+    const int width = buffer_width;
+    const int height = buffer_height;
+    const int step = buffer_step;
+    // A new view that had no preview replaces everything.
+    const bool fresh = display_view_version != buffer_view_version || width != display_width ||
+                       height != display_height;
+    display_buffer.resize(static_cast<size_t>(width) * height);
+    display_stretch.resize(static_cast<size_t>(width) * height);
+    this->pool->parallelFor(height, [&](int y) {
+        const int* row = &iteration_buffer[static_cast<size_t>(y - y % step) * width];
+        int* shown = &display_buffer[static_cast<size_t>(y) * width];
+        float* stretch = &display_stretch[static_cast<size_t>(y) * width];
+        for (int x = 0; x < width; x++) {
+            if (fresh || step == 1 || stretch[x] > step) {
+                shown[x] = row[x - x % step];
+                stretch[x] = static_cast<float>(step);
+            }
+        }
+    });
+    display_width = width;
+    display_height = height;
+    display_iterations = buffer_iterations;
+    display_type = fractal_type;
+    display_center_re = center_re;
+    display_center_im = center_im;
+    display_range_re = range_re;
+    display_range_im = range_im;
+    display_view_version = buffer_view_version;
+}
+
+// Packs the palette sampled at its steps into the byte order of the pixels. The entry after the
+// steps is for the iteration limit, which is drawn with the first color.
+void Fractal::updatePaletteLut() {
+    if (lut_palette_version == palette_version)
+        return;
+    const unsigned int max_color = colors.size() - 1;
+    palette_lut.resize(palette_lut_steps + 1);
+    for (int i = 0; i <= palette_lut_steps; i++) {
+        int current_step = i == palette_lut_steps ? 0 : i;
+        auto color_value = (static_cast<double>(current_step) / palette_lut_steps) * max_color;
+        auto i_col = static_cast<unsigned int>(color_value);
+        PaletteColor col = linearInterpolation(colors[i_col], colors[min(i_col + 1, max_color)], color_value - i_col);
+        const uint8_t bytes[4] = {col.r, col.g, col.b, 255};
+        memcpy(&palette_lut[i], bytes, sizeof(bytes));
     }
+    lut_palette_version = palette_version;
 }
 
+// Colors the image from what it shows. Palette changes only need this pass.
+void Fractal::colorFractal() {
+    const int width = display_width;
+    const int height = display_height;
+    if (display_buffer.empty())
+        return;
+    updatePaletteLut();
+    const ColorKernel color = selectColorKernel(this->kernel_isa);
+    this->pool->parallelFor(height, [&](int y) {
+        color(&display_buffer[static_cast<size_t>(y) * width], width, palette_lut.data(), display_iterations,
+              img->getPackedPixels() + static_cast<size_t>(y) * img->getWidth());
+    });
+}
+
+// Renders The Fractal on the shared thread pool. Iterates only if the view changed and colors only if the
+// iterations or the palette changed. Returns false if the image is already up to date
+// or the frame got cancelled. In progressive mode every call renders the next pass,
+// needsRender() tells whether passes are left. A zoom first shows the last image scaled
+// to the new view.
+bool Fractal::renderFractal(int width, int height, double time_delta) {
+    if (!needsRender(width, height, time_delta))
+        return false;
+    if (needsIteration(width, height, time_delta)) {
+        int step = buffer_step / 2;
+        bool pan = false;
+        int shift_x = 0, shift_y = 0;
+        // Passes that refine the buffer run at the limit it was started with.
+        this->max_iterations = computeIterations(width);
+        if (isBufferStale(width, height, time_delta)) {
+            KernelPrecision precision = selectPrecision(width);
+            if (precision == KernelPrecision::perturbation || precision == KernelPrecision::extended_perturbation) {
+                reference_orbit = reference_cache.find(fractal_type, center_re, center_im, max_iterations);
+                shared_ptr<BlaTable> table = make_shared<BlaTable>();
+                computeBlaTable(*table, *reference_orbit, fractal_type,
+                                sqrt(range_re * range_re + range_im * range_im) / 2,
+                                precision == KernelPrecision::extended_perturbation);
+                bla_table = table;
+            }
+            computed_iterations = 0;
+            pan = findPanShift(width, height, shift_x, shift_y);
+            int preview_step = pan || !this->progressive ? 0 : reprojectDisplay(width, height);
+            if (preview_step != 0) {
+                // The preview is shown on its own, the passes continue at the next call.
+                buffer_width = width;
+                buffer_height = height;
+                buffer_iterations = max_iterations;
+                buffer_time = time_delta;
+                buffer_view_version = view_version;
+                buffer_step = preview_step * 2;
+                buffer_preview = true;
+                colorFractal();
+                image_palette_version = palette_version;
+                return true;
+            }
+            if (!pan) {
+                buffer_step = 0;
+                step = this->progressive ? 8 : 1;
+            }
+        }
+        bool iterated = pan ? iteratePan(width, height, time_delta, shift_x, shift_y) :
+                        iterateFractal(width, height, time_delta, step);
+        if (!iterated)
+            return false;
+        composeDisplay();
+    }
+    colorFractal();
+    image_palette_version = palette_version;
+    return true;
+}
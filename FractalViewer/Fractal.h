@@ -1,20 +1,17 @@
 #ifndef FRACTALVIEWER_FRACTAL_H
 #define FRACTALVIEWER_FRACTAL_H
 
-#include <SFML/Graphics.hpp>
-#include <omp.h>
 #include <cstdio>
 #include <cmath>
+#include <atomic>
+#include "FractalTypes.h"
+#include "Kernel.h"
+#include "BigFixed.h"
+#include "Perturbation.h"
+#include "ReferenceCache.h"
+#include "TileScheduler.h"
+#include "PixelBuffer.h"
 using namespace std;
-using namespace sf;
-
-enum class FractalTypes {
-    mandelbrot = 1,
-    tricorn,
-    mandelbrot_tricorn_animation,
-    burning_ship,
-    experiment
-};
 
 struct FractalSettings {
     double min_real_x;
@@ -32,27 +29,141 @@ class Fractal {
     FractalSettings limit_tricorn = { -2.5, 1.0, -1.0, 1.0 , 1.5, 0, 2 };
     FractalSettings limit_mandelbrot_tricorn_animation = { -2.5, 1.0, -1.0, 0.75 , 1, 0, 2 };
     FractalSettings limit_burning_ship = { -2.5, 1.0, -1.0, 1.0 , 1, -0.75, 1.5 };
-    FractalSettings current_frac_settings{};
-    Image* img;
+    // The view is kept as center and extent. The center is the reference point of perturbation
+    // and carries as many bits as the zoom depth needs, the extent only needs to be relative to it
+    // but has to reach below the range of double.
+    BigFixed center_re;
+    BigFixed center_im;
+    FloatExp range_re;
+    FloatExp range_im;
+    PixelBuffer* img;
     FractalTypes fractal_type;
     float escape_radius;
     bool dynamic_iterations;
     int max_iterations;
-    static Color linearInterpolation(const Color& col1, const Color& col2, double t);
+    KernelIsa kernel_isa;
+    vector<PaletteColor> colors;
+    // Packed pixels of the palette sampled at palette_lut_steps points and the color of the
+    // limit, rebuilt when the palette changes.
+    vector<uint32_t> palette_lut;
+    unsigned long lut_palette_version;
+    // Bumped by every change that needs the fractal to be iterated or colored again.
+    unsigned long view_version;
+    unsigned long palette_version;
+    // Escape time results of the last iterated frame, kept so recoloring doesn't iterate again.
+    vector<int> iteration_buffer;
+    int buffer_width;
+    int buffer_height;
+    int buffer_iterations;
+    double buffer_time;
+    // Spacing of the computed samples in the buffer, 1 once every pixel is done and 0 before the first pass.
+    int buffer_step;
+    // View of the buffer, pans by whole pixels shift it instead of computing it again. The center
+    // is kept on the pixel grid of the frame the buffer was first computed for.
+    FractalTypes buffer_type;
+    RenderMethod buffer_render_method;
+    BigFixed buffer_center_re;
+    BigFixed buffer_center_im;
+    FloatExp buffer_range_re;
+    FloatExp buffer_range_im;
+    // Set while the buffer has no samples of its view yet and the image is a preview.
+    bool buffer_preview;
+    // Iterations the image shows and how many pixels wide the sample behind every pixel is,
+    // 1 where it is exact. A zoom scales the last image to the new view as a preview right
+    // away, the passes after it start as coarse as its most stretched or missing pixels allow
+    // and only replace pixels they sample more densely than the preview.
+    vector<int> display_buffer;
+    vector<float> display_stretch;
+    int display_width;
+    int display_height;
+    int display_iterations;
+    FractalTypes display_type;
+    BigFixed display_center_re;
+    BigFixed display_center_im;
+    FloatExp display_range_re;
+    FloatExp display_range_im;
+    unsigned long display_view_version;
+    bool progressive;
+    RenderMethod render_method;
+    static const int subdivision_tile_size = 64;
+    static const int render_tile_size = 32;
+    // Iterations the kernels ran for the passes of the current image.
+    int64_t computed_iterations;
+    // Milliseconds every tile of the last pass took and the size of those tiles.
+    vector<float> tile_times;
+    int timed_tile_size;
+    // Pans within this fraction of a pixel from a whole pixel shift reuse the buffer.
+    static constexpr double pan_tolerance = 1e-3;
+    // Cycle detection tolerance in pixels.
+    static constexpr double periodicity_tolerance = 1e-4;
+    // Above this pixel spacing float rounding moves a pixel by less than a ten thousandth of its
+    // size, the few pixels that change are the ones a subpixel shift of the view changes as well.
+    static constexpr double single_precision_spacing = 1e-3;
+    // Below this pixel spacing double coordinates can't tell pixels apart and double-double takes over.
+    static constexpr double double_double_spacing = 1e-13;
+    // Below this one double-double runs out as well and perturbation takes over.
+    static constexpr double perturbation_spacing = 1e-24;
+    // Below this one the offsets of the pixels approach the subnormal range of double and
+    // perturbation continues in FloatExp.
+    static constexpr double extended_perturbation_spacing = 1e-290;
+    ReferenceCache reference_cache;
+    shared_ptr<ReferenceOrbit> reference_orbit;
+    // Replaced for every view, never changed in place, so copies of the fractal can share it.
+    shared_ptr<const BlaTable> bla_table;
+    unsigned long buffer_view_version;
+    unsigned long image_palette_version;
+    const atomic<bool>* cancel_flag;
+    ThreadPool* pool;
+    static PaletteColor linearInterpolation(const PaletteColor& col1, const PaletteColor& col2, double t);
+    int computeIterations(int width) const;
+    bool usesSubdivision() const;
+    KernelPrecision selectPrecision(int width) const;
+    void updatePrecision();
+    bool isBufferStale(int width, int height, double time_delta) const;
+    bool needsIteration(int width, int height, double time_delta) const;
+    vector<float> estimateTileCosts(int width, int height, int tile_size, int step, bool refine) const;
+    SpanKernel prepareKernel(int width, int height, double time_delta, KernelParams& params) const;
+    bool findPanShift(int width, int height, int& shift_x, int& shift_y) const;
+    bool iteratePan(int width, int height, double time_delta, int shift_x, int shift_y);
+    bool iterateFractal(int width, int height, double time_delta, int step);
+    int reprojectDisplay(int width, int height);
+    void composeDisplay();
+    void updatePaletteLut();
+    void colorFractal();
 
 public:
-    Fractal(Image* img, bool dynamicIterations, float escapeRadius);
+    Fractal(PixelBuffer* img, bool dynamicIterations, float escapeRadius);
     ~Fractal();
     int getIterations() const;
     void setIterations(int amount);
     FractalTypes getFractalType();
     void setFractalType(FractalTypes newFracType);
     const char* getName();
+    const char* getKernelName(int width) const;
+    const char* getPrecisionName(int width) const;
     FractalSettings getFracSettings() const;
     void setFracSettings(FractalSettings newSettings);
-    void setImage(Image *newImage);
+    void setView(const BigFixed& centerRe, const BigFixed& centerIm, const FloatExp& rangeRe, const FloatExp& rangeIm);
+    void moveView(double x, double y);
+    void zoomView(double x, double y, double factor);
+    void setImage(PixelBuffer* newImage);
+    void setCancelFlag(const atomic<bool>* flag);
+    void setThreadPool(ThreadPool* newPool);
+    void syncView(const Fractal& view);
+    unsigned long getViewVersion() const;
+    unsigned long getPaletteVersion() const;
+    void setColors(const vector<PaletteColor>& newColors);
     void toggleIterationMode();
-    void renderFractal(vector<Color> colors, int width, int height, double time_delta);
+    void setProgressive(bool enabled);
+    void setRenderMethod(RenderMethod method);
+    RenderMethod getRenderMethod() const;
+    const vector<float>& getTileTimes() const;
+    int getTileSize() const;
+    const vector<int>& getIterationCounts() const;
+    int64_t getComputedIterations() const;
+    bool isAnimated() const;
+    bool needsRender(int width, int height, double time_delta) const;
+    bool renderFractal(int width, int height, double time_delta);
 };
 
 #endif //FRACTALVIEWER_FRACTAL_H
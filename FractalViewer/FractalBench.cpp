@@ -0,0 +1,265 @@
+// Renders a fixed set of views and reports the throughput, to compare builds and machines.
+// Every case is rendered with a new Fractal, so the times include the reference orbit and
+// everything else a first frame of that view needs, and the best of the repeats is kept.
+// Giter/s counts the iterations the kernels ran. Equivalent Giter/s counts the iterations
+// the pixels of the image show, as if every pixel had been iterated to its count. The gap
+// between them is what subdivision, the cardioid test, cycle detection and the perturbation
+// skips saved.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include "Fractal.h"
+#include "ThreadPool.h"
+using namespace std;
+
+struct Viewport {
+    const char* name;
+    FractalTypes type;
+    const char* center_re;
+    const char* center_im;
+    double range;
+    vector<int> iterations;
+};
+
+// The iteration limits are picked so the higher one changes the work: pixels still escape
+// between the limits. The deep spiral needs about 10000 iterations before the first pixel escapes.
+static const vector<Viewport> viewports{
+    {"zoomed-out", FractalTypes::mandelbrot, "-0.75", "0", 3.5, {256, 2048}},
+    {"seahorse-valley", FractalTypes::mandelbrot,
+     "-0.743643887037158704752191506114774", "0.131825904205311970493132056385139", 1e-6, {1000, 10000}},
+    {"deep-spiral", FractalTypes::mandelbrot,
+     "-0.743643887037158704752191506114774", "0.131825904205311970493132056385139", 1e-22, {20000}},
+    {"burning-ship-antenna", FractalTypes::burning_ship, "-1.7621", "-0.028", 0.045, {1000, 5000}},
+    {"interior", FractalTypes::mandelbrot, "-0.1", "0", 1.2, {1000, 10000}},
+};
+
+static const vector<PaletteColor> bench_colors{
+    {0, 0, 0},
+    {0, 7, 100},
+    {32, 107, 203},
+    {237, 255, 255},
+    {255, 170, 0},
+    {0, 2, 0}
+};
+
+struct BenchOptions {
+    vector<pair<int, int>> sizes{{640, 360}, {1920, 1080}};
+    vector<int> threads;
+    int repeats = 3;
+    RenderMethod method = RenderMethod::subdivision;
+    string filter;
+    string json;
+};
+
+struct BenchResult {
+    const Viewport* viewport;
+    int width;
+    int height;
+    int iterations;
+    int threads;
+    double seconds;
+    double computed_iterations;
+    double equivalent_iterations;
+    const char* kernel;
+    const char* precision;
+};
+
+static void printUsage() {
+    cerr << "Usage: fractalbench [options]\n"
+            "  --sizes <w>x<h>,...     resolutions, default 640x360,1920x1080\n"
+            "  --threads <n>,...       thread counts, default 1, the powers of two and every core\n"
+            "  --repeats <n>           renders per case, the fastest counts, default 3\n"
+            "  --method <name>         subdivision or per-pixel\n"
+            "  --only <name>           only the viewports whose name contains this\n"
+            "  --json <file>           also write the results as JSON\n";
+}
+
+static bool parseList(const string& text, vector<string>& items) {
+    items.clear();
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == string::npos)
+            end = text.size();
+        items.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+    return !items.empty();
+}
+
+static bool parseArguments(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        vector<string> items;
+        if (arg == "--sizes" && i + 1 < argc && parseList(argv[++i], items)) {
+            options.sizes.clear();
+            for (const string& item : items) {
+                int width, height;
+                if (sscanf(item.c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+                    return false;
+                options.sizes.emplace_back(width, height);
+            }
+        } else if (arg == "--threads" && i + 1 < argc && parseList(argv[++i], items)) {
+            options.threads.clear();
+            for (const string& item : items) {
+                int count = atoi(item.c_str());
+                if (count <= 0)
+                    return false;
+                options.threads.push_back(count);
+            }
+        } else if (arg == "--repeats" && i + 1 < argc) {
+            options.repeats = atoi(argv[++i]);
+            if (options.repeats <= 0)
+                return false;
+        } else if (arg == "--method" && i + 1 < argc) {
+            string method = argv[++i];
+            if (method != "subdivision" && method != "per-pixel")
+                return false;
+            options.method = method == "subdivision" ? RenderMethod::subdivision : RenderMethod::per_pixel;
+        } else if (arg == "--only" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            options.json = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 1, the powers of two below the core count and the core count itself.
+static vector<int> defaultThreadCounts() {
+    int cores = max(1, static_cast<int>(thread::hardware_concurrency()));
+    vector<int> counts;
+    for (int count = 1; count < cores; count *= 2)
+        counts.push_back(count);
+    counts.push_back(cores);
+    return counts;
+}
+
+static BenchResult runCase(const Viewport& viewport, int width, int height, int iterations,
+                           ThreadPool& pool, const BenchOptions& options) {
+    BenchResult result{&viewport, width, height, iterations, pool.getThreadCount(), 0, 0, 0, "", ""};
+    FloatExp range_re(viewport.range);
+    FloatExp range_im = range_re * (static_cast<double>(height) / width);
+    int limbs = BigFixed::limbsForScale(range_im);
+    BigFixed center_re, center_im;
+    BigFixed::parse(viewport.center_re, limbs, center_re);
+    BigFixed::parse(viewport.center_im, limbs, center_im);
+
+    PixelBuffer pixels;
+    pixels.create(width, height);
+    for (int repeat = 0; repeat < options.repeats; repeat++) {
+        Fractal fractal(&pixels, false, 1000);
+        fractal.setThreadPool(&pool);
+        fractal.setFractalType(viewport.type);
+        fractal.setView(center_re, center_im, range_re, range_im);
+        fractal.setIterations(iterations);
+        fractal.setColors(bench_colors);
+        fractal.setRenderMethod(options.method);
+
+        auto start = chrono::steady_clock::now();
+        fractal.renderFractal(width, height, 0);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (repeat == 0 || seconds < result.seconds)
+            result.seconds = seconds;
+
+        if (repeat == 0) {
+            double total = 0;
+            for (int count : fractal.getIterationCounts())
+                total += count;
+            result.equivalent_iterations = total;
+            result.computed_iterations = static_cast<double>(fractal.getComputedIterations());
+            result.kernel = fractal.getKernelName(width);
+            result.precision = fractal.getPrecisionName(width);
+        }
+    }
+    return result;
+}
+
+// Time of the same case with one thread, 0 when that wasn't measured.
+static double singleThreadSeconds(const vector<BenchResult>& results, const BenchResult& result) {
+    for (const BenchResult& other : results) {
+        if (other.threads == 1 && other.viewport == result.viewport && other.width == result.width &&
+            other.height == result.height && other.iterations == result.iterations)
+            return other.seconds;
+    }
+    return 0;
+}
+
+static bool writeJson(const string& path, const vector<BenchResult>& results, const BenchOptions& options) {
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == nullptr)
+        return false;
+    fprintf(file, "{\n  \"hardware_threads\": %u,\n  \"method\": \"%s\",\n  \"repeats\": %d,\n  \"results\": [",
+            thread::hardware_concurrency(),
+            options.method == RenderMethod::subdivision ? "subdivision" : "per-pixel", options.repeats);
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& result = results[i];
+        double single = singleThreadSeconds(results, result);
+        double speedup = single > 0 ? single / result.seconds : 0;
+        fprintf(file, "%s\n    {\"viewport\": \"%s\", \"width\": %d, \"height\": %d, \"iterations\": %d, "
+                      "\"threads\": %d, \"kernel\": \"%s\", \"precision\": \"%s\", \"seconds\": %.6f, "
+                      "\"mpixels_per_second\": %.3f, \"giterations_per_second\": %.4f, "
+                      "\"equivalent_giterations_per_second\": %.4f, \"speedup\": %.3f, \"efficiency\": %.3f}",
+                i == 0 ? "" : ",", result.viewport->name, result.width, result.height, result.iterations,
+                result.threads, result.kernel, result.precision, result.seconds,
+                result.width * static_cast<double>(result.height) / result.seconds / 1e6,
+                result.computed_iterations / result.seconds / 1e9,
+                result.equivalent_iterations / result.seconds / 1e9,
+                speedup, speedup / result.threads);
+    }
+    fprintf(file, "\n  ]\n}\n");
+    return fclose(file) == 0;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+    if (options.threads.empty())
+        options.threads = defaultThreadCounts();
+
+    vector<unique_ptr<ThreadPool>> pools;
+    for (int count : options.threads)
+        pools.emplace_back(new ThreadPool(count));
+
+    printf("%-22s %11s %7s %7s %-24s %10s %9s %9s %11s %7s\n",
+           "viewport", "size", "iter", "threads", "kernel", "ms", "Mpix/s", "Giter/s", "Equiv Giter", "speedup");
+    vector<BenchResult> results;
+    for (const Viewport& viewport : viewports) {
+        if (string(viewport.name).find(options.filter) == string::npos)
+            continue;
+        for (const pair<int, int>& size : options.sizes) {
+            for (int iterations : viewport.iterations) {
+                for (unique_ptr<ThreadPool>& pool : pools) {
+                    results.push_back(runCase(viewport, size.first, size.second, iterations, *pool, options));
+                    const BenchResult& result = results.back();
+                    double single = singleThreadSeconds(results, result);
+                    string kernel = string(result.kernel) + " " + result.precision;
+                    printf("%-22s %5dx%-5d %7d %7d %-24s %10.1f %9.2f %9.3f %11.3f %7.2f\n",
+                           viewport.name, result.width, result.height, result.iterations, result.threads,
+                           kernel.c_str(), result.seconds * 1000,
+                           result.width * static_cast<double>(result.height) / result.seconds / 1e6,
+                           result.computed_iterations / result.seconds / 1e9,
+                           result.equivalent_iterations / result.seconds / 1e9,
+                           single > 0 ? single / result.seconds : 0.0);
+                    fflush(stdout);
+                }
+            }
+        }
+    }
+
+    if (!options.json.empty() && !writeJson(options.json, results, options)) {
+        cerr << "Could not write " << options.json << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
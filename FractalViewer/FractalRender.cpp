@@ -0,0 +1,191 @@
+// Renders a single image to a file without opening a window, for batch jobs on machines
+// without a display. It only uses the engine library, so it builds without SFML.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "Fractal.h"
+#include "ImageWriter.h"
+using namespace std;
+
+// Same default palette as the viewer.
+static const vector<PaletteColor> default_colors{
+    {0, 0, 0},
+    {0, 7, 100},
+    {32, 107, 203},
+    {237, 255, 255},
+    {255, 170, 0},
+    {0, 2, 0}
+};
+
+struct RenderOptions {
+    FractalTypes type = FractalTypes::mandelbrot;
+    int width = 1920;
+    int height = 1080;
+    int iterations = 0;
+    double time = 0;
+    RenderMethod method = RenderMethod::subdivision;
+    vector<PaletteColor> colors = default_colors;
+    bool has_view = false;
+    FractalSettings view = {0, 0, 0, 0, 0, 0, 1};
+    string center_re;
+    string center_im;
+    string range;
+    string output;
+};
+
+static void printUsage() {
+    cerr << "Usage: fractalrender [options] -o <file.png|.ppm>\n"
+            "  --type <name>           mandelbrot, tricorn, animation, burning-ship or experiment\n"
+            "  --size <w>x<h>          image size in pixels, default 1920x1080\n"
+            "  --view <re0> <re1> <im0> <im1>\n"
+            "                          corners of the view\n"
+            "  --center <re> <im>      center as decimal numbers of any length, for deep zooms\n"
+            "  --range <width>         width of the view around the center, like 3.5 or 1e-400.\n"
+            "                          The height follows the aspect ratio of the image\n"
+            "  --iterations <n>        iteration limit, grows with the zoom if left out\n"
+            "  --palette <hex,...>     colors as rrggbb, like 000000,00076a,206bcb\n"
+            "  --time <t>              time of the Ma-Tri animation\n"
+            "  --method <name>         subdivision or per-pixel\n";
+}
+
+static bool parseType(const string& name, FractalTypes& type) {
+    const char* names[] = {"mandelbrot", "tricorn", "animation", "burning-ship", "experiment"};
+    for (int i = 0; i < 5; i++) {
+        if (name == names[i]) {
+            type = static_cast<FractalTypes>(i + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parsePalette(const string& text, vector<PaletteColor>& colors) {
+    colors.clear();
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t end = text.find(',', start);
+        if (end == string::npos)
+            end = text.size();
+        string hex = text.substr(start, end - start);
+        char* rest;
+        unsigned long rgb = strtoul(hex.c_str(), &rest, 16);
+        if (hex.size() != 6 || *rest != '\0')
+            return false;
+        colors.emplace_back((rgb >> 16) & 0xff, (rgb >> 8) & 0xff, rgb & 0xff);
+        start = end + 1;
+    }
+    return colors.size() >= 2;
+}
+
+// Reads a number like 2.5e-400, whose exponent is out of the range of double.
+static bool parseRange(const string& text, FloatExp& range) {
+    size_t split = text.find_first_of("eE");
+    char* rest;
+    double mantissa = strtod(text.substr(0, split).c_str(), &rest);
+    if (*rest != '\0' || !(mantissa > 0))
+        return false;
+    long exponent = 0;
+    if (split != string::npos) {
+        exponent = strtol(text.c_str() + split + 1, &rest, 10);
+        if (*rest != '\0' || labs(exponent) > 100000000)
+            return false;
+    }
+    FloatExp power(1.0);
+    FloatExp base(exponent < 0 ? 0.1 : 10.0);
+    for (long remaining = labs(exponent); remaining != 0; remaining >>= 1) {
+        if (remaining & 1)
+            power = power * base;
+        base = base * base;
+    }
+    range = FloatExp(mantissa) * power;
+    return true;
+}
+
+static bool parseArguments(int argc, char* argv[], RenderOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        int left = argc - i - 1;
+        if ((arg == "-o" || arg == "--output") && left >= 1) {
+            options.output = argv[++i];
+        } else if (arg == "--type" && left >= 1) {
+            if (!parseType(argv[++i], options.type))
+                return false;
+        } else if (arg == "--size" && left >= 1) {
+            if (sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 ||
+                options.width <= 0 || options.height <= 0)
+                return false;
+        } else if (arg == "--view" && left >= 4) {
+            options.has_view = true;
+            options.view.min_real_x = atof(argv[++i]);
+            options.view.max_real_x = atof(argv[++i]);
+            options.view.min_im_y = atof(argv[++i]);
+            options.view.max_im_y = atof(argv[++i]);
+        } else if (arg == "--center" && left >= 2) {
+            options.center_re = argv[++i];
+            options.center_im = argv[++i];
+        } else if (arg == "--range" && left >= 1) {
+            options.range = argv[++i];
+        } else if (arg == "--iterations" && left >= 1) {
+            options.iterations = atoi(argv[++i]);
+            if (options.iterations <= 0)
+                return false;
+        } else if (arg == "--palette" && left >= 1) {
+            if (!parsePalette(argv[++i], options.colors))
+                return false;
+        } else if (arg == "--time" && left >= 1) {
+            options.time = atof(argv[++i]);
+        } else if (arg == "--method" && left >= 1) {
+            string method = argv[++i];
+            if (method != "subdivision" && method != "per-pixel")
+                return false;
+            options.method = method == "subdivision" ? RenderMethod::subdivision : RenderMethod::per_pixel;
+        } else {
+            return false;
+        }
+    }
+    return !options.output.empty() && options.center_re.empty() == options.range.empty();
+}
+
+int main(int argc, char* argv[]) {
+    RenderOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    PixelBuffer pixels;
+    pixels.create(options.width, options.height);
+    Fractal fractal(&pixels, options.iterations == 0, 1000);
+    fractal.setFractalType(options.type);
+    if (options.iterations != 0)
+        fractal.setIterations(options.iterations);
+    if (options.has_view)
+        fractal.setFracSettings(options.view);
+    if (!options.range.empty()) {
+        FloatExp range_re;
+        BigFixed center_re, center_im;
+        if (!parseRange(options.range, range_re)) {
+            cerr << "Invalid range: " << options.range << endl;
+            return EXIT_FAILURE;
+        }
+        FloatExp range_im = range_re * (static_cast<double>(options.height) / options.width);
+        int limbs = BigFixed::limbsForScale(range_im);
+        if (!BigFixed::parse(options.center_re, limbs, center_re) ||
+            !BigFixed::parse(options.center_im, limbs, center_im)) {
+            cerr << "Invalid center: " << options.center_re << " " << options.center_im << endl;
+            return EXIT_FAILURE;
+        }
+        fractal.setView(center_re, center_im, range_re, range_im);
+    }
+    fractal.setColors(options.colors);
+    fractal.setRenderMethod(options.method);
+    fractal.renderFractal(options.width, options.height, options.time);
+
+    if (!saveImage(pixels, options.output)) {
+        cerr << "Could not write " << options.output << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,34 @@
+#ifndef FRACTALVIEWER_FRACTALTYPES_H
+#define FRACTALVIEWER_FRACTALTYPES_H
+
+#include <cstdint>
+
+enum class FractalTypes {
+    mandelbrot = 1,
+    tricorn,
+    mandelbrot_tricorn_animation,
+    burning_ship,
+    experiment
+};
+
+enum class RenderMethod {
+    per_pixel,
+    subdivision
+};
+
+// Entry of a palette. The images are opaque, so there is no alpha.
+struct PaletteColor {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+
+    PaletteColor() : r(0), g(0), b(0) {}
+    PaletteColor(uint8_t r, uint8_t g, uint8_t b) : r(r), g(g), b(b) {}
+};
+
+inline bool operator==(const PaletteColor& a, const PaletteColor& b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+inline bool operator!=(const PaletteColor& a, const PaletteColor& b) { return !(a == b); }
+
+#endif //FRACTALVIEWER_FRACTALTYPES_H
@@ -0,0 +1,145 @@
+#include "ImageWriter.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static bool hasExtension(const string& path, const char* extension) {
+    size_t length = strlen(extension);
+    if (path.size() < length)
+        return false;
+    for (size_t i = 0; i < length; i++) {
+        if (tolower(static_cast<unsigned char>(path[path.size() - length + i])) != extension[i])
+            return false;
+    }
+    return true;
+}
+
+// Binary PPM, which has no alpha channel.
+bool savePpm(const PixelBuffer& pixels, const string& path) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    fprintf(file, "P6\n%d %d\n255\n", pixels.getWidth(), pixels.getHeight());
+    const uint8_t* rgba = pixels.getPixels();
+    vector<uint8_t> row(static_cast<size_t>(pixels.getWidth()) * 3);
+    bool written = true;
+    for (int y = 0; y < pixels.getHeight() && written; y++) {
+        for (int x = 0; x < pixels.getWidth(); x++) {
+            const uint8_t* pixel = rgba + (static_cast<size_t>(y) * pixels.getWidth() + x) * 4;
+            memcpy(&row[static_cast<size_t>(x) * 3], pixel, 3);
+        }
+        written = fwrite(row.data(), 1, row.size(), file) == row.size();
+    }
+    return fclose(file) == 0 && written;
+}
+
+static void appendBigEndian(vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static vector<uint32_t> makeCrcTable() {
+    vector<uint32_t> table(256);
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        table[i] = c;
+    }
+    return table;
+}
+
+static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0) {
+    static const vector<uint32_t> table = makeCrcTable();
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+// Chunks are the length, the type, the data and a CRC over the type and the data.
+static bool writeChunk(FILE* file, const char* type, const vector<uint8_t>& data) {
+    vector<uint8_t> chunk;
+    chunk.reserve(data.size() + 12);
+    appendBigEndian(chunk, static_cast<uint32_t>(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    appendBigEndian(chunk, crc32(chunk.data() + 4, data.size() + 4));
+    return fwrite(chunk.data(), 1, chunk.size(), file) == chunk.size();
+}
+
+// RGB PNG whose image data is a zlib stream of stored deflate blocks.
+bool savePng(const PixelBuffer& pixels, const string& path) {
+    const int width = pixels.getWidth();
+    const int height = pixels.getHeight();
+    const size_t row_size = static_cast<size_t>(width) * 3 + 1;
+
+    // Every row starts with filter type 0, the bytes are taken as they are.
+    vector<uint8_t> raw(row_size * height);
+    const uint8_t* rgba = pixels.getPixels();
+    for (int y = 0; y < height; y++) {
+        uint8_t* row = &raw[row_size * y];
+        row[0] = 0;
+        for (int x = 0; x < width; x++)
+            memcpy(row + 1 + static_cast<size_t>(x) * 3, rgba + (static_cast<size_t>(y) * width + x) * 4, 3);
+    }
+
+    const size_t max_block = 65535;
+    vector<uint8_t> compressed;
+    compressed.reserve(raw.size() + (raw.size() / max_block + 1) * 5 + 6);
+    compressed.push_back(0x78);
+    compressed.push_back(0x01);
+    size_t offset = 0;
+    do {
+        size_t length = min(max_block, raw.size() - offset);
+        bool last = offset + length == raw.size();
+        compressed.push_back(last ? 1 : 0);
+        compressed.push_back(static_cast<uint8_t>(length));
+        compressed.push_back(static_cast<uint8_t>(length >> 8));
+        compressed.push_back(static_cast<uint8_t>(~length));
+        compressed.push_back(static_cast<uint8_t>(~length >> 8));
+        compressed.insert(compressed.end(), raw.begin() + offset, raw.begin() + offset + length);
+        offset += length;
+    } while (offset < raw.size());
+
+    // Adler-32 of the uncompressed data. The sums are reduced before they can overflow.
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < raw.size();) {
+        size_t end = min(raw.size(), i + 5552);
+        for (; i < end; i++) {
+            a += raw[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    appendBigEndian(compressed, (b << 16) | a);
+
+    vector<uint8_t> header;
+    appendBigEndian(header, static_cast<uint32_t>(width));
+    appendBigEndian(header, static_cast<uint32_t>(height));
+    const uint8_t format[5] = {8, 2, 0, 0, 0};
+    header.insert(header.end(), format, format + 5);
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    bool written = fwrite(signature, 1, sizeof(signature), file) == sizeof(signature) &&
+                   writeChunk(file, "IHDR", header) &&
+                   writeChunk(file, "IDAT", compressed) &&
+                   writeChunk(file, "IEND", vector<uint8_t>());
+    return fclose(file) == 0 && written;
+}
+
+bool saveImage(const PixelBuffer& pixels, const string& path) {
+    if (hasExtension(path, ".ppm"))
+        return savePpm(pixels, path);
+    if (hasExtension(path, ".png"))
+        return savePng(pixels, path);
+    return false;
+}
@@ -0,0 +1,17 @@
+#ifndef FRACTALVIEWER_IMAGEWRITER_H
+#define FRACTALVIEWER_IMAGEWRITER_H
+
+#include <string>
+#include "PixelBuffer.h"
+using namespace std;
+
+// Writes rendered images without an image library, so the engine can be used on machines
+// that don't have SFML. The PNG files are not compressed, which keeps the writer small and
+// fast. Tools that care about the size can recompress them.
+bool savePpm(const PixelBuffer& pixels, const string& path);
+bool savePng(const PixelBuffer& pixels, const string& path);
+
+// Picks the format from the extension of the path, .ppm or .png.
+bool saveImage(const PixelBuffer& pixels, const string& path);
+
+#endif //FRACTALVIEWER_IMAGEWRITER_H
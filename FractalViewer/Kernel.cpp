@@ -0,0 +1,265 @@
+#include "Kernel.h"
+#include "Formulas.h"
+#include "DoubleDouble.h"
+#include "Perturbation.h"
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FRACTALVIEWER_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#ifdef FRACTALVIEWER_X86
+static void cpuid(int leaf, int subleaf, unsigned int regs[4]) {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, leaf, subleaf);
+    for (int i = 0; i < 4; i++)
+        regs[i] = static_cast<unsigned int>(r[i]);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Reads the XCR0 register which tells which register sets the OS saves on a context switch.
+static unsigned long long xgetbv0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+// Picks the widest kernel the CPU and the OS support.
+KernelIsa detectKernelIsa() {
+#ifdef FRACTALVIEWER_X86
+    unsigned int regs[4];
+    cpuid(0, 0, regs);
+    if (regs[0] < 7)
+        return KernelIsa::scalar;
+    cpuid(1, 0, regs);
+    bool osxsave = (regs[2] & (1u << 27)) != 0;
+    bool avx = (regs[2] & (1u << 28)) != 0;
+    if (!osxsave || !avx)
+        return KernelIsa::scalar;
+    unsigned long long xcr0 = xgetbv0();
+    bool ymm_state = (xcr0 & 0x6) == 0x6;
+    bool zmm_state = (xcr0 & 0xe6) == 0xe6;
+    cpuid(7, 0, regs);
+    bool avx2 = (regs[1] & (1u << 5)) != 0;
+    bool avx512f = (regs[1] & (1u << 16)) != 0;
+    if (avx512f && zmm_state)
+        return KernelIsa::avx512;
+    if (avx2 && ymm_state)
+        return KernelIsa::avx2;
+#endif
+    return KernelIsa::scalar;
+}
+
+const char* getKernelIsaName(KernelIsa isa) {
+    switch (isa) {
+        case KernelIsa::avx2:
+            return "AVX2";
+        case KernelIsa::avx512:
+            return "AVX-512";
+        default:
+            return "Scalar";
+    }
+}
+
+// True if c lies in the main cardioid or the period-2 bulb of the Mandelbrot set.
+template<class Real>
+static inline bool insideMainComponents(Real x0, Real y0) {
+    Real x = x0 - Real(0.25);
+    Real y2 = y0 * y0;
+    Real q = x * x + y2;
+    if (q * (q + x) <= Real(0.25) * y2)
+        return true;
+    return (x0 + Real(1)) * (x0 + Real(1)) + y2 <= Real(0.0625);
+}
+
+// Scalar escape time loop, instantiated once per formula and for double and float.
+template<class Formula, class Real>
+static int64_t iterateSpanScalar(const KernelParams& params, const PixelSpan& span, int* iterations) {
+    const Real factor = static_cast<Real>(params.im_factor);
+    const Real min_re = static_cast<Real>(params.min_real_x);
+    const Real range_re = static_cast<Real>(params.range_real_x);
+    const Real min_im = static_cast<Real>(params.min_im_y);
+    const Real range_im = static_cast<Real>(params.range_im_y);
+    const Real tolerance = static_cast<Real>(params.periodicity_tolerance);
+    int64_t ran = 0;
+    for (int i = 0; i < span.count; i++) {
+        Real x0 = min_re + range_re * static_cast<Real>(span.x + i * span.dx) / static_cast<Real>(params.width);
+        Real y0 = min_im + range_im * static_cast<Real>(span.y + i * span.dy) / static_cast<Real>(params.height);
+        Real re = 0, im = 0;
+        if (Formula::cardioid && insideMainComponents(x0, y0)) {
+            iterations[i * span.stride] = params.max_iterations;
+            continue;
+        }
+        // Brent's cycle detection: compare against a saved point that moves after 1, 2, 4, ... iterations.
+        Real check_re = 0, check_im = 0;
+        int check_interval = 1, since_check = 0;
+        int current_iteration = 0;
+        bool cycled = false;
+        for (; current_iteration < params.max_iterations; current_iteration++) {
+            Formula::step(re, im, x0, y0, factor);
+            if (re * re + im * im > 4) {
+                break;
+            }
+            if (Formula::periodic) {
+                if (std::abs(re - check_re) + std::abs(im - check_im) < tolerance) {
+                    cycled = true;
+                    break;
+                }
+                if (++since_check == check_interval) {
+                    check_re = re;
+                    check_im = im;
+                    check_interval *= 2;
+                    since_check = 0;
+                }
+            }
+        }
+        ran += current_iteration;
+        iterations[i * span.stride] = cycled ? params.max_iterations : current_iteration;
+    }
+    return ran;
+}
+
+// Same loop in double-double for views between the reach of double and perturbation.
+// Only the high parts decide about escaping, the cycle check uses the full difference.
+template<class Formula>
+static int64_t iterateSpanDoubleDouble(const KernelParams& params, const PixelSpan& span, int* iterations) {
+    typedef DoubleDouble<double> DD;
+    const DD min_re(params.min_real_x, params.min_real_x_lo);
+    const DD min_im(params.min_im_y, params.min_im_y_lo);
+    const DD factor(params.im_factor);
+    int64_t ran = 0;
+    for (int i = 0; i < span.count; i++) {
+        DD x0 = min_re + DD(params.range_real_x * (span.x + i * span.dx) / params.width);
+        DD y0 = min_im + DD(params.range_im_y * (span.y + i * span.dy) / params.height);
+        DD re(0.0), im(0.0);
+        DD check_re(0.0), check_im(0.0);
+        int check_interval = 1, since_check = 0;
+        int current_iteration = 0;
+        bool cycled = false;
+        for (; current_iteration < params.max_iterations; current_iteration++) {
+            Formula::step(re, im, x0, y0, factor);
+            if (re.hi * re.hi + im.hi * im.hi > 4) {
+                break;
+            }
+            if (Formula::periodic) {
+                if (std::abs((re - check_re).hi) + std::abs((im - check_im).hi) < params.periodicity_tolerance) {
+                    cycled = true;
+                    break;
+                }
+                if (++since_check == check_interval) {
+                    check_re = re;
+                    check_im = im;
+                    check_interval *= 2;
+                    since_check = 0;
+                }
+            }
+        }
+        ran += current_iteration;
+        iterations[i * span.stride] = cycled ? params.max_iterations : current_iteration;
+    }
+    return ran;
+}
+
+static SpanKernel selectSpanKernelDoubleDouble(FractalTypes type) {
+    switch (type) {
+        case FractalTypes::mandelbrot:
+            return iterateSpanDoubleDouble<MandelbrotFormula>;
+        case FractalTypes::tricorn:
+            return iterateSpanDoubleDouble<TricornFormula>;
+        case FractalTypes::burning_ship:
+            return iterateSpanDoubleDouble<BurningShipFormula>;
+        default:
+            return nullptr;
+    }
+}
+
+static SpanKernel selectSpanKernelScalar(FractalTypes type) {
+    switch (type) {
+        case FractalTypes::mandelbrot:
+            return iterateSpanScalar<MandelbrotFormula, double>;
+        case FractalTypes::tricorn:
+            return iterateSpanScalar<TricornFormula, double>;
+        case FractalTypes::mandelbrot_tricorn_animation:
+            return iterateSpanScalar<MandelbrotTricornFormula, double>;
+        case FractalTypes::burning_ship:
+            return iterateSpanScalar<BurningShipFormula, double>;
+        default:
+            return iterateSpanScalar<ExperimentFormula, double>;
+    }
+}
+
+// The experiment formula only exists for double.
+static SpanKernel selectSpanKernelSingle(FractalTypes type) {
+    switch (type) {
+        case FractalTypes::mandelbrot:
+            return iterateSpanScalar<MandelbrotFormula, float>;
+        case FractalTypes::tricorn:
+            return iterateSpanScalar<TricornFormula, float>;
+        case FractalTypes::mandelbrot_tricorn_animation:
+            return iterateSpanScalar<MandelbrotTricornFormula, float>;
+        case FractalTypes::burning_ship:
+            return iterateSpanScalar<BurningShipFormula, float>;
+        default:
+            return nullptr;
+    }
+}
+
+// Picks the kernel for a frame. Formulas without a vectorized version fall back to scalar.
+// Returns nullptr if the formula isn't available in that precision, double always is.
+SpanKernel selectSpanKernel(FractalTypes type, KernelIsa isa, KernelPrecision precision) {
+    if (precision == KernelPrecision::perturbation || precision == KernelPrecision::extended_perturbation)
+        return selectPerturbationKernel(type, precision == KernelPrecision::extended_perturbation);
+    SpanKernel kernel = nullptr;
+    switch (isa) {
+        case KernelIsa::avx512:
+            kernel = selectSpanKernelAvx512(type, precision);
+            break;
+        case KernelIsa::avx2:
+            kernel = selectSpanKernelAvx2(type, precision);
+            break;
+        default:
+            break;
+    }
+    if (kernel != nullptr)
+        return kernel;
+    if (precision == KernelPrecision::single_precision)
+        return selectSpanKernelSingle(type);
+    if (precision == KernelPrecision::double_double)
+        return selectSpanKernelDoubleDouble(type);
+    return selectSpanKernelScalar(type);
+}
+
+static void colorSpanScalar(const int* iterations, int count, const uint32_t* palette, int limit, uint32_t* pixels) {
+    const float scale = paletteScale(limit);
+    for (int i = 0; i < count; i++)
+        pixels[i] = palette[paletteIndex(iterations[i], limit, scale)];
+}
+
+ColorKernel selectColorKernel(KernelIsa isa) {
+    switch (isa) {
+        case KernelIsa::avx512:
+            if (selectColorKernelAvx512() != nullptr)
+                return selectColorKernelAvx512();
+            break;
+        case KernelIsa::avx2:
+            if (selectColorKernelAvx2() != nullptr)
+                return selectColorKernelAvx2();
+            break;
+        default:
+            break;
+    }
+    return colorSpanScalar;
+}
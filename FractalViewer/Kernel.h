@@ -0,0 +1,99 @@
+#ifndef FRACTALVIEWER_KERNEL_H
+#define FRACTALVIEWER_KERNEL_H
+
+#include <cstdint>
+#include "FractalTypes.h"
+
+struct ReferenceOrbit;
+struct BlaTable;
+
+// Instruction sets the escape time kernel can be compiled for.
+enum class KernelIsa {
+    scalar,
+    avx2,
+    avx512
+};
+
+// Arithmetic the escape time loop runs in, chosen from the pixel spacing of the view.
+enum class KernelPrecision {
+    single_precision,
+    double_precision,
+    double_double,
+    perturbation,
+    extended_perturbation
+};
+
+// Everything the escape time loop needs to know about a frame.
+// im_factor is the 2 * sin(t) of the Mandelbrot-Tricorn animation.
+// An orbit that comes back within periodicity_tolerance of an earlier point is treated as
+// trapped in a cycle. The tolerance scales with the pixel size.
+// Perturbation kernels read the pixel coordinates as offsets from the reference orbit's point
+// and skip iterations with the view's table of bla steps.
+// Extended perturbation kernels scale them by 2^offset_exponent, which double can't hold.
+// Double-double kernels add the _lo parts to the view corner.
+struct KernelParams {
+    double min_real_x;
+    double min_real_x_lo;
+    double range_real_x;
+    double min_im_y;
+    double min_im_y_lo;
+    double range_im_y;
+    int width;
+    int height;
+    int max_iterations;
+    double im_factor;
+    double periodicity_tolerance;
+    const ReferenceOrbit* reference;
+    const BlaTable* bla;
+    int offset_exponent;
+};
+
+// A run of count pixels starting at (x, y) and advancing by (dx, dy) per pixel.
+// The results of pixel i are written to index i * stride of the output arrays.
+struct PixelSpan {
+    int x;
+    int y;
+    int dx;
+    int dy;
+    int count;
+    int stride;
+};
+
+// Computes the iteration counts of a span.
+// Returns how many iterations the loop actually ran. Pixels decided without iterating add
+// nothing and trapped orbits only add the iterations up to the cycle check that caught them.
+typedef int64_t (*SpanKernel)(const KernelParams& params, const PixelSpan& span, int* iterations);
+
+// Entries the palette is sampled at, independent of the iteration limit. The palette holds
+// one more entry for the points that reached the limit.
+const int palette_lut_steps = 4096;
+
+// Entry of an iteration count. Counts are spread over the palette steps up to the limit.
+// The SIMD kernels do the same float math, so every kernel picks the same entries.
+inline int paletteIndex(int iterations, int limit, float scale) {
+    if (iterations >= limit)
+        return palette_lut_steps;
+    int index = static_cast<int>(static_cast<float>(iterations) * scale);
+    return index < palette_lut_steps - 1 ? index : palette_lut_steps - 1;
+}
+
+inline float paletteScale(int limit) {
+    return static_cast<float>(palette_lut_steps) / static_cast<float>(limit);
+}
+
+// Looks up the palette entries of count iteration counts that were iterated up to limit.
+typedef void (*ColorKernel)(const int* iterations, int count, const uint32_t* palette, int limit, uint32_t* pixels);
+
+KernelIsa detectKernelIsa();
+const char* getKernelIsaName(KernelIsa isa);
+SpanKernel selectSpanKernel(FractalTypes type, KernelIsa isa, KernelPrecision precision);
+ColorKernel selectColorKernel(KernelIsa isa);
+
+// Implemented in their own translation units which are compiled with the matching instruction set.
+// They return nullptr for formulas that have no vectorized version.
+SpanKernel selectSpanKernelAvx2(FractalTypes type, KernelPrecision precision);
+SpanKernel selectSpanKernelAvx512(FractalTypes type, KernelPrecision precision);
+ColorKernel selectColorKernelAvx2();
+ColorKernel selectColorKernelAvx512();
+
+#endif //FRACTALVIEWER_KERNEL_H
@@ -0,0 +1,137 @@
+// Compiled with AVX2 enabled. Only call into this file after detectKernelIsa() said so.
+#include "Kernel.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#include "KernelSimd.h"
+#include <algorithm>
+
+namespace {
+
+// Four doubles. Lanes that escaped are masked out of the counter.
+struct VecAvx2 {
+    typedef __m256d Mask;
+    static const int lanes = 4;
+    __m256d v;
+
+    VecAvx2(__m256d v) : v(v) {}
+    explicit VecAvx2(double d) : v(_mm256_set1_pd(d)) {}
+
+    static VecAvx2 ramp(int start, int step) {
+        return _mm256_set_pd(start + 3 * step, start + 2 * step, start + step, start);
+    }
+    static Mask allLanes() { return _mm256_castsi256_pd(_mm256_set1_epi64x(-1LL)); }
+    static Mask notGreater(Mask active, const VecAvx2& a, const VecAvx2& b) {
+        return _mm256_andnot_pd(_mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ), active);
+    }
+    static Mask lessThan(Mask active, const VecAvx2& a, const VecAvx2& b) {
+        return _mm256_and_pd(_mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ), active);
+    }
+    static Mask clear(Mask active, Mask lanes) { return _mm256_andnot_pd(lanes, active); }
+    static Mask either(Mask a, Mask b) { return _mm256_or_pd(a, b); }
+    static bool none(Mask active) { return _mm256_movemask_pd(active) == 0; }
+    static VecAvx2 maskedAdd(const VecAvx2& a, Mask active, const VecAvx2& b) {
+        return _mm256_add_pd(a.v, _mm256_and_pd(active, b.v));
+    }
+    static VecAvx2 select(Mask active, const VecAvx2& a, const VecAvx2& b) {
+        return _mm256_blendv_pd(b.v, a.v, active);
+    }
+    void storeInt(int* out) const {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_cvtpd_epi32(v));
+    }
+};
+
+inline VecAvx2 operator+(const VecAvx2& a, const VecAvx2& b) { return _mm256_add_pd(a.v, b.v); }
+inline VecAvx2 operator-(const VecAvx2& a, const VecAvx2& b) { return _mm256_sub_pd(a.v, b.v); }
+inline VecAvx2 operator*(const VecAvx2& a, const VecAvx2& b) { return _mm256_mul_pd(a.v, b.v); }
+inline VecAvx2 operator/(const VecAvx2& a, const VecAvx2& b) { return _mm256_div_pd(a.v, b.v); }
+inline VecAvx2 abs(const VecAvx2& a) {
+    return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v);
+}
+inline VecAvx2 flipSign(const VecAvx2& value, const VecAvx2& sign) {
+    return _mm256_xor_pd(value.v, _mm256_and_pd(sign.v, _mm256_set1_pd(-0.0)));
+}
+
+// Eight floats for shallow views, same interface as VecAvx2.
+struct VecAvx2Float {
+    typedef __m256 Mask;
+    static const int lanes = 8;
+    __m256 v;
+
+    VecAvx2Float(__m256 v) : v(v) {}
+    explicit VecAvx2Float(double d) : v(_mm256_set1_ps(static_cast<float>(d))) {}
+
+    static VecAvx2Float ramp(int start, int step) {
+        return _mm256_add_ps(_mm256_set1_ps(static_cast<float>(start)),
+                             _mm256_mul_ps(_mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0), _mm256_set1_ps(static_cast<float>(step))));
+    }
+    static Mask allLanes() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+    static Mask notGreater(Mask active, const VecAvx2Float& a, const VecAvx2Float& b) {
+        return _mm256_andnot_ps(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ), active);
+    }
+    static Mask lessThan(Mask active, const VecAvx2Float& a, const VecAvx2Float& b) {
+        return _mm256_and_ps(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ), active);
+    }
+    static Mask clear(Mask active, Mask lanes) { return _mm256_andnot_ps(lanes, active); }
+    static Mask either(Mask a, Mask b) { return _mm256_or_ps(a, b); }
+    static bool none(Mask active) { return _mm256_movemask_ps(active) == 0; }
+    static VecAvx2Float maskedAdd(const VecAvx2Float& a, Mask active, const VecAvx2Float& b) {
+        return _mm256_add_ps(a.v, _mm256_and_ps(active, b.v));
+    }
+    static VecAvx2Float select(Mask active, const VecAvx2Float& a, const VecAvx2Float& b) {
+        return _mm256_blendv_ps(b.v, a.v, active);
+    }
+    void storeInt(int* out) const {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_cvtps_epi32(v));
+    }
+};
+
+inline VecAvx2Float operator+(const VecAvx2Float& a, const VecAvx2Float& b) { return _mm256_add_ps(a.v, b.v); }
+inline VecAvx2Float operator-(const VecAvx2Float& a, const VecAvx2Float& b) { return _mm256_sub_ps(a.v, b.v); }
+inline VecAvx2Float operator*(const VecAvx2Float& a, const VecAvx2Float& b) { return _mm256_mul_ps(a.v, b.v); }
+inline VecAvx2Float operator/(const VecAvx2Float& a, const VecAvx2Float& b) { return _mm256_div_ps(a.v, b.v); }
+inline VecAvx2Float abs(const VecAvx2Float& a) {
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v);
+}
+
+}
+
+SpanKernel selectSpanKernelAvx2(FractalTypes type, KernelPrecision precision) {
+    return selectSpanKernelSimd<VecAvx2, VecAvx2Float>(type, precision);
+}
+
+// Eight palette entries per gather.
+static void colorSpanAvx2(const int* iterations, int count, const uint32_t* palette, int limit, uint32_t* pixels) {
+    const float scale = paletteScale(limit);
+    const __m256i limits = _mm256_set1_epi32(limit);
+    const __m256 scales = _mm256_set1_ps(scale);
+    const __m256i last_step = _mm256_set1_epi32(palette_lut_steps - 1);
+    const __m256i limit_entry = _mm256_set1_epi32(palette_lut_steps);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i counts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(iterations + i));
+        __m256i index = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(counts), scales));
+        index = _mm256_min_epi32(index, last_step);
+        index = _mm256_blendv_epi8(limit_entry, index, _mm256_cmpgt_epi32(limits, counts));
+        __m256i color = _mm256_i32gather_epi32(reinterpret_cast<const int*>(palette), index, 4);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + i), color);
+    }
+    for (; i < count; i++)
+        pixels[i] = palette[paletteIndex(iterations[i], limit, scale)];
+}
+
+ColorKernel selectColorKernelAvx2() {
+    return colorSpanAvx2;
+}
+
+#else
+
+SpanKernel selectSpanKernelAvx2(FractalTypes, KernelPrecision) {
+    return nullptr;
+}
+
+ColorKernel selectColorKernelAvx2() {
+    return nullptr;
+}
+
+#endif
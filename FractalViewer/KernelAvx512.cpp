@@ -0,0 +1,136 @@
+// Compiled with AVX-512 enabled. Only call into this file after detectKernelIsa() said so.
+#include "Kernel.h"
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#include "KernelSimd.h"
+
+namespace {
+
+// Eight doubles, the active lanes live in a mask register.
+struct VecAvx512 {
+    typedef __mmask8 Mask;
+    static const int lanes = 8;
+    __m512d v;
+
+    VecAvx512(__m512d v) : v(v) {}
+    explicit VecAvx512(double d) : v(_mm512_set1_pd(d)) {}
+
+    static VecAvx512 ramp(int start, int step) {
+        __m512d lane = _mm512_set_pd(7, 6, 5, 4, 3, 2, 1, 0);
+        return _mm512_add_pd(_mm512_set1_pd(start), _mm512_mul_pd(lane, _mm512_set1_pd(step)));
+    }
+    static Mask allLanes() { return 0xff; }
+    static Mask notGreater(Mask active, const VecAvx512& a, const VecAvx512& b) {
+        return _mm512_mask_cmp_pd_mask(active, a.v, b.v, _CMP_NGT_UQ);
+    }
+    static Mask lessThan(Mask active, const VecAvx512& a, const VecAvx512& b) {
+        return _mm512_mask_cmp_pd_mask(active, a.v, b.v, _CMP_LT_OQ);
+    }
+    static Mask clear(Mask active, Mask lanes) { return active & static_cast<Mask>(~lanes); }
+    static Mask either(Mask a, Mask b) { return static_cast<Mask>(a | b); }
+    static bool none(Mask active) { return active == 0; }
+    static VecAvx512 maskedAdd(const VecAvx512& a, Mask active, const VecAvx512& b) {
+        return _mm512_mask_add_pd(a.v, active, a.v, b.v);
+    }
+    static VecAvx512 select(Mask active, const VecAvx512& a, const VecAvx512& b) {
+        return _mm512_mask_blend_pd(active, b.v, a.v);
+    }
+    // The zero-masked conversions, because GCC's unmasked ones start from an undefined vector
+    // and -Wall warns about it. With every lane set they are the same instruction.
+    void storeInt(int* out) const {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm512_maskz_cvtpd_epi32(allLanes(), v));
+    }
+};
+
+inline VecAvx512 operator+(const VecAvx512& a, const VecAvx512& b) { return _mm512_add_pd(a.v, b.v); }
+inline VecAvx512 operator-(const VecAvx512& a, const VecAvx512& b) { return _mm512_sub_pd(a.v, b.v); }
+inline VecAvx512 operator*(const VecAvx512& a, const VecAvx512& b) { return _mm512_mul_pd(a.v, b.v); }
+inline VecAvx512 operator/(const VecAvx512& a, const VecAvx512& b) { return _mm512_div_pd(a.v, b.v); }
+inline VecAvx512 abs(const VecAvx512& a) { return _mm512_abs_pd(a.v); }
+// The floating point xor needs AVX512DQ, the integer one is part of AVX512F.
+inline VecAvx512 flipSign(const VecAvx512& value, const VecAvx512& sign) {
+    __m512i sign_bit = _mm512_and_si512(_mm512_castpd_si512(sign.v), _mm512_set1_epi64(0x8000000000000000LL));
+    return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(value.v), sign_bit));
+}
+
+
+// Sixteen floats for shallow views, same interface as VecAvx512.
+struct VecAvx512Float {
+    typedef __mmask16 Mask;
+    static const int lanes = 16;
+    __m512 v;
+
+    VecAvx512Float(__m512 v) : v(v) {}
+    explicit VecAvx512Float(double d) : v(_mm512_set1_ps(static_cast<float>(d))) {}
+
+    static VecAvx512Float ramp(int start, int step) {
+        __m512 lane = _mm512_set_ps(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+        return _mm512_add_ps(_mm512_set1_ps(static_cast<float>(start)), _mm512_mul_ps(lane, _mm512_set1_ps(static_cast<float>(step))));
+    }
+    static Mask allLanes() { return 0xffff; }
+    static Mask notGreater(Mask active, const VecAvx512Float& a, const VecAvx512Float& b) {
+        return _mm512_mask_cmp_ps_mask(active, a.v, b.v, _CMP_NGT_UQ);
+    }
+    static Mask lessThan(Mask active, const VecAvx512Float& a, const VecAvx512Float& b) {
+        return _mm512_mask_cmp_ps_mask(active, a.v, b.v, _CMP_LT_OQ);
+    }
+    static Mask clear(Mask active, Mask lanes) { return active & static_cast<Mask>(~lanes); }
+    static Mask either(Mask a, Mask b) { return static_cast<Mask>(a | b); }
+    static bool none(Mask active) { return active == 0; }
+    static VecAvx512Float maskedAdd(const VecAvx512Float& a, Mask active, const VecAvx512Float& b) {
+        return _mm512_mask_add_ps(a.v, active, a.v, b.v);
+    }
+    static VecAvx512Float select(Mask active, const VecAvx512Float& a, const VecAvx512Float& b) {
+        return _mm512_mask_blend_ps(active, b.v, a.v);
+    }
+    void storeInt(int* out) const {
+        _mm512_storeu_si512(out, _mm512_maskz_cvtps_epi32(allLanes(), v));
+    }
+};
+
+inline VecAvx512Float operator+(const VecAvx512Float& a, const VecAvx512Float& b) { return _mm512_add_ps(a.v, b.v); }
+inline VecAvx512Float operator-(const VecAvx512Float& a, const VecAvx512Float& b) { return _mm512_sub_ps(a.v, b.v); }
+inline VecAvx512Float operator*(const VecAvx512Float& a, const VecAvx512Float& b) { return _mm512_mul_ps(a.v, b.v); }
+inline VecAvx512Float operator/(const VecAvx512Float& a, const VecAvx512Float& b) { return _mm512_div_ps(a.v, b.v); }
+inline VecAvx512Float abs(const VecAvx512Float& a) { return _mm512_abs_ps(a.v); }
+
+}
+
+SpanKernel selectSpanKernelAvx512(FractalTypes type, KernelPrecision precision) {
+    return selectSpanKernelSimd<VecAvx512, VecAvx512Float>(type, precision);
+}
+
+// Sixteen palette entries per gather, the end of the span is masked.
+static void colorSpanAvx512(const int* iterations, int count, const uint32_t* palette, int limit, uint32_t* pixels) {
+    const __m512i limits = _mm512_set1_epi32(limit);
+    const __m512 scales = _mm512_set1_ps(paletteScale(limit));
+    const __m512i last_step = _mm512_set1_epi32(palette_lut_steps - 1);
+    const __m512i limit_entry = _mm512_set1_epi32(palette_lut_steps);
+    for (int i = 0; i < count; i += 16) {
+        const __mmask16 lanes = count - i >= 16 ? static_cast<__mmask16>(0xffff) :
+                                static_cast<__mmask16>((1u << (count - i)) - 1);
+        __m512i counts = _mm512_maskz_loadu_epi32(lanes, iterations + i);
+        __m512i index = _mm512_maskz_cvttps_epi32(lanes, _mm512_mul_ps(_mm512_maskz_cvtepi32_ps(lanes, counts), scales));
+        index = _mm512_maskz_min_epi32(lanes, index, last_step);
+        index = _mm512_mask_blend_epi32(_mm512_cmplt_epi32_mask(counts, limits), limit_entry, index);
+        __m512i color = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), lanes, index, palette, 4);
+        _mm512_mask_storeu_epi32(pixels + i, lanes, color);
+    }
+}
+
+ColorKernel selectColorKernelAvx512() {
+    return colorSpanAvx512;
+}
+
+#else
+
+SpanKernel selectSpanKernelAvx512(FractalTypes, KernelPrecision) {
+    return nullptr;
+}
+
+ColorKernel selectColorKernelAvx512() {
+    return nullptr;
+}
+
+#endif
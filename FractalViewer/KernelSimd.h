@@ -0,0 +1,190 @@
+#ifndef FRACTALVIEWER_KERNELSIMD_H
+#define FRACTALVIEWER_KERNELSIMD_H
+
+#include "Kernel.h"
+#include "Formulas.h"
+#include "DoubleDouble.h"
+
+// Escape time loop shared by the SIMD translation units. V is a vector of doubles or floats
+// defined in an anonymous namespace of each of those files, so every instantiation
+// stays local to the file that was compiled with the matching instruction set.
+// V provides the arithmetic used by the formulas plus:
+//   lanes, Mask, ramp(start, step), allLanes(), notGreater(), lessThan(), clear(), either(), none(),
+//   maskedAdd(), select(), storeInt() and a flipSign() overload for the double-double abs().
+// The counter of a lane only runs while the lane is active, so it holds the iterations the lane
+// ran. Lanes that never escape are marked as trapped and set to the limit after the loop.
+template<class V, class Formula>
+int64_t iterateSpanSimd(const KernelParams& params, const PixelSpan& span, int* iterations) {
+    typedef typename V::Mask Mask;
+    const V min_re(params.min_real_x);
+    const V range_re(params.range_real_x);
+    const V width(static_cast<double>(params.width));
+    const V min_im(params.min_im_y);
+    const V range_im(params.range_im_y);
+    const V height(static_cast<double>(params.height));
+    const V factor(params.im_factor);
+    const V bailout(4.0);
+    const V one(1.0);
+    const V tolerance(params.periodicity_tolerance);
+    const V max_count(static_cast<double>(params.max_iterations));
+    const V quarter(0.25);
+    const V sixteenth(0.0625);
+    int64_t ran = 0;
+
+    for (int i = 0; i < span.count; i += V::lanes) {
+        V x0 = min_re + range_re * V::ramp(span.x + i * span.dx, span.dx) / width;
+        V y0 = min_im + range_im * V::ramp(span.y + i * span.dy, span.dy) / height;
+        V re(0.0), im(0.0), count(0.0);
+        V check_re(0.0), check_im(0.0);
+        int check_interval = 1, since_check = 0;
+        Mask active = V::allLanes();
+        Mask trapped = V::clear(active, active);
+        if (Formula::cardioid) {
+            // Lanes inside the main cardioid or the period-2 bulb never escape, a block made
+            // only of those leaves the loop after the first step.
+            V x = x0 - quarter;
+            V y2 = y0 * y0;
+            V q = x * x + y2;
+            V bulb_x = x0 + one;
+            active = V::clear(active, V::notGreater(V::allLanes(), q * (q + x), quarter * y2));
+            active = V::clear(active, V::notGreater(V::allLanes(), bulb_x * bulb_x + y2, sixteenth));
+            trapped = V::clear(V::allLanes(), active);
+        }
+        for (int n = 0; n < params.max_iterations; n++) {
+            Formula::step(re, im, x0, y0, factor);
+            active = V::notGreater(active, re * re + im * im, bailout);
+            if (Formula::periodic) {
+                // Brent's cycle detection, the schedule is the same for all lanes.
+                Mask cycled = V::lessThan(active, abs(re - check_re) + abs(im - check_im), tolerance);
+                trapped = V::either(trapped, cycled);
+                active = V::clear(active, cycled);
+                if (++since_check == check_interval) {
+                    check_re = re;
+                    check_im = im;
+                    check_interval *= 2;
+                    since_check = 0;
+                }
+            }
+            if (V::none(active))
+                break;
+            count = V::maskedAdd(count, active, one);
+        }
+
+        int lanes[V::lanes];
+        int lanes_ran[V::lanes];
+        V::select(trapped, max_count, count).storeInt(lanes);
+        count.storeInt(lanes_ran);
+        for (int lane = 0; lane < V::lanes && i + lane < span.count; lane++) {
+            iterations[(i + lane) * span.stride] = lanes[lane];
+            ran += lanes_ran[lane];
+        }
+    }
+    return ran;
+}
+
+// Double-double version of the loop above. The lanes escape on the high parts alone.
+template<class V, class Formula>
+int64_t iterateSpanDoubleDoubleSimd(const KernelParams& params, const PixelSpan& span, int* iterations) {
+    typedef typename V::Mask Mask;
+    typedef DoubleDouble<V> DD;
+    const DD min_re(V(params.min_real_x), V(params.min_real_x_lo));
+    const V range_re(params.range_real_x);
+    const V width(static_cast<double>(params.width));
+    const DD min_im(V(params.min_im_y), V(params.min_im_y_lo));
+    const V range_im(params.range_im_y);
+    const V height(static_cast<double>(params.height));
+    const V zero(0.0);
+    const DD factor(params.im_factor);
+    const V bailout(4.0);
+    const V one(1.0);
+    const V tolerance(params.periodicity_tolerance);
+    const V max_count(static_cast<double>(params.max_iterations));
+    int64_t ran = 0;
+
+    for (int i = 0; i < span.count; i += V::lanes) {
+        DD x0 = min_re + DD(range_re * V::ramp(span.x + i * span.dx, span.dx) / width, zero);
+        DD y0 = min_im + DD(range_im * V::ramp(span.y + i * span.dy, span.dy) / height, zero);
+        DD re(0.0), im(0.0);
+        DD check_re(0.0), check_im(0.0);
+        V count(0.0);
+        int check_interval = 1, since_check = 0;
+        Mask active = V::allLanes();
+        Mask trapped = V::clear(active, active);
+        for (int n = 0; n < params.max_iterations; n++) {
+            Formula::step(re, im, x0, y0, factor);
+            active = V::notGreater(active, re.hi * re.hi + im.hi * im.hi, bailout);
+            if (Formula::periodic) {
+                Mask cycled = V::lessThan(active, abs((re - check_re).hi) + abs((im - check_im).hi), tolerance);
+                trapped = V::either(trapped, cycled);
+                active = V::clear(active, cycled);
+                if (++since_check == check_interval) {
+                    check_re = re;
+                    check_im = im;
+                    check_interval *= 2;
+                    since_check = 0;
+                }
+            }
+            if (V::none(active))
+                break;
+            count = V::maskedAdd(count, active, one);
+        }
+
+        int lanes[V::lanes];
+        int lanes_ran[V::lanes];
+        V::select(trapped, max_count, count).storeInt(lanes);
+        count.storeInt(lanes_ran);
+        for (int lane = 0; lane < V::lanes && i + lane < span.count; lane++) {
+            iterations[(i + lane) * span.stride] = lanes[lane];
+            ran += lanes_ran[lane];
+        }
+    }
+    return ran;
+}
+
+template<class V>
+SpanKernel selectSpanKernelDoubleDoubleSimd(FractalTypes type) {
+    switch (type) {
+        case FractalTypes::mandelbrot:
+            return iterateSpanDoubleDoubleSimd<V, MandelbrotFormula>;
+        case FractalTypes::tricorn:
+            return iterateSpanDoubleDoubleSimd<V, TricornFormula>;
+        case FractalTypes::burning_ship:
+            return iterateSpanDoubleDoubleSimd<V, BurningShipFormula>;
+        default:
+            return nullptr;
+    }
+}
+
+// Maps a formula to its vectorized kernel, nullptr if the formula is scalar only.
+template<class V>
+SpanKernel selectEscapeKernelSimd(FractalTypes type) {
+    switch (type) {
+        case FractalTypes::mandelbrot:
+            return iterateSpanSimd<V, MandelbrotFormula>;
+        case FractalTypes::tricorn:
+            return iterateSpanSimd<V, TricornFormula>;
+        case FractalTypes::mandelbrot_tricorn_animation:
+            return iterateSpanSimd<V, MandelbrotTricornFormula>;
+        case FractalTypes::burning_ship:
+            return iterateSpanSimd<V, BurningShipFormula>;
+        default:
+            return nullptr;
+    }
+}
+
+// Picks among the kernels of one instruction set, D and F being its double and float vectors.
+template<class D, class F>
+SpanKernel selectSpanKernelSimd(FractalTypes type, KernelPrecision precision) {
+    switch (precision) {
+        case KernelPrecision::single_precision:
+            return selectEscapeKernelSimd<F>(type);
+        case KernelPrecision::double_precision:
+            return selectEscapeKernelSimd<D>(type);
+        case KernelPrecision::double_double:
+            return selectSpanKernelDoubleDoubleSimd<D>(type);
+        default:
+            return nullptr;
+    }
+}
+
+#endif //FRACTALVIEWER_KERNELSIMD_H
@@ -0,0 +1,244 @@
+#include "Perturbation.h"
+#include "Formulas.h"
+#include <algorithm>
+#include <cmath>
+
+// Iterates the point until it escapes, storing z after every step including z0 = 0.
+// The precision is the one of the center, which the view sizes from the zoom depth.
+template<class Formula>
+static void extendOrbit(ReferenceOrbit& orbit, const BigFixed& center_re, const BigFixed& center_im,
+                        int max_iterations) {
+    const BigFixed factor;
+    BigFixed re = orbit.last_re;
+    BigFixed im = orbit.last_im;
+    for (int n = static_cast<int>(orbit.re.size()) - 1; n < max_iterations && !orbit.escaped; n++) {
+        Formula::step(re, im, center_re, center_im, factor);
+        double z_re = re.toDouble();
+        double z_im = im.toDouble();
+        orbit.re.push_back(z_re);
+        orbit.im.push_back(z_im);
+        if (z_re * z_re + z_im * z_im > 4)
+            orbit.escaped = true;
+    }
+    orbit.last_re = re;
+    orbit.last_im = im;
+}
+
+void extendReferenceOrbit(ReferenceOrbit& orbit, FractalTypes type, const BigFixed& center_re,
+                          const BigFixed& center_im, int max_iterations) {
+    switch (type) {
+        case FractalTypes::mandelbrot:
+            extendOrbit<MandelbrotFormula>(orbit, center_re, center_im, max_iterations);
+            break;
+        case FractalTypes::tricorn:
+            extendOrbit<TricornFormula>(orbit, center_re, center_im, max_iterations);
+            break;
+        case FractalTypes::burning_ship:
+            extendOrbit<BurningShipFormula>(orbit, center_re, center_im, max_iterations);
+            break;
+        default:
+            orbit.re.clear();
+            orbit.im.clear();
+            orbit.escaped = true;
+            break;
+    }
+}
+
+void computeReferenceOrbit(ReferenceOrbit& orbit, FractalTypes type, const BigFixed& center_re,
+                           const BigFixed& center_im, int max_iterations) {
+    orbit.re.assign(1, 0.0);
+    orbit.im.assign(1, 0.0);
+    orbit.last_re = BigFixed();
+    orbit.last_im = BigFixed();
+    orbit.escaped = false;
+    extendReferenceOrbit(orbit, type, center_re, center_im, max_iterations);
+}
+
+// The quadratic term d^2 of a Mandelbrot step may be dropped while it stays below the
+// rounding error of the linear term 2 * Z * d, so |d| < epsilon * |2 * Z|.
+static const double bla_epsilon = 1.0 / 9007199254740992.0;
+
+// Applying x and then y: d -> A_y * (A_x * d + B_x * dc) + B_y * dc. The radius of x is
+// shrunk so that the offset after x, which grows by at most |B_x| * max_offset, is still
+// within the radius of y. Radii that come out negative or undefined close the step.
+template<class T>
+static BlaStep<T> mergeBla(const BlaStep<T>& x, const BlaStep<T>& y, const T& max_offset) {
+    using std::sqrt;
+    BlaStep<T> merged;
+    merged.a_re = y.a_re * x.a_re - y.a_im * x.a_im;
+    merged.a_im = y.a_re * x.a_im + y.a_im * x.a_re;
+    merged.b_re = y.a_re * x.b_re - y.a_im * x.b_im + y.b_re;
+    merged.b_im = y.a_re * x.b_im + y.a_im * x.b_re + y.b_im;
+    T a_x = sqrt(x.a_re * x.a_re + x.a_im * x.a_im);
+    T b_x = sqrt(x.b_re * x.b_re + x.b_im * x.b_im);
+    T radius_y = (sqrt(y.radius2) - b_x * max_offset) / a_x;
+    T radius = sqrt(x.radius2);
+    if (radius_y < radius)
+        radius = radius_y;
+    if (!(radius > T(0.0)))
+        radius = T(0.0);
+    merged.radius2 = radius * radius;
+    merged.length = x.length + y.length;
+    return merged;
+}
+
+template<class T>
+static void buildBlaTable(vector<vector<BlaStep<T>>>& bla, const ReferenceOrbit& orbit, const T& max_offset) {
+    using std::sqrt;
+    const int last = static_cast<int>(orbit.re.size()) - 1;
+    // Z_0 is 0 and has no linear part, the table starts after it.
+    vector<BlaStep<T>> level(max(last - 1, 0));
+    for (int m = 1; m < last; m++) {
+        BlaStep<T>& step = level[m - 1];
+        step.a_re = T(2 * orbit.re[m]);
+        step.a_im = T(2 * orbit.im[m]);
+        step.b_re = T(1.0);
+        step.b_im = T(0.0);
+        T radius = T(bla_epsilon) * sqrt(step.a_re * step.a_re + step.a_im * step.a_im);
+        step.radius2 = radius * radius;
+        step.length = 1;
+    }
+    // Single steps skip nothing, only the levels above them are kept.
+    while (level.size() >= 2) {
+        vector<BlaStep<T>> merged(level.size() / 2);
+        for (size_t j = 0; j < merged.size(); j++)
+            merged[j] = mergeBla(level[2 * j], level[2 * j + 1], max_offset);
+        bla.push_back(merged);
+        level.swap(merged);
+    }
+}
+
+void computeBlaTable(BlaTable& table, const ReferenceOrbit& orbit, FractalTypes type, const FloatExp& max_offset,
+                     bool extended) {
+    table.steps.clear();
+    table.extended_steps.clear();
+    if (type != FractalTypes::mandelbrot)
+        return;
+    if (extended)
+        buildBlaTable(table.extended_steps, orbit, max_offset);
+    else
+        buildBlaTable(table.steps, orbit, max_offset.toDouble());
+}
+
+static inline const vector<vector<BlaStep<double>>>& blaSteps(const BlaTable& table, double) {
+    return table.steps;
+}
+
+static inline const vector<vector<BlaStep<FloatExp>>>& blaSteps(const BlaTable& table, const FloatExp&) {
+    return table.extended_steps;
+}
+
+static inline double toDouble(double value) {
+    return value;
+}
+
+static inline double toDouble(const FloatExp& value) {
+    return value.toDouble();
+}
+
+// Offsets of the double kernels are plain doubles, their offset_exponent is 0.
+static inline void makeOffset(double& offset, double value, int) {
+    offset = value;
+}
+
+static inline void makeOffset(FloatExp& offset, double value, int exponent) {
+    offset = FloatExp(value, exponent);
+}
+
+// Largest table step that starts at iteration m of the reference, keeps the pixel within
+// max_steps and is valid for the offset, nullptr if there is none. Level k only has steps
+// starting where m - 1 is a multiple of 2^(k+1), so odd m - 1 needs no lookup at all.
+template<class T>
+static inline const BlaStep<T>* findBla(const vector<vector<BlaStep<T>>>& bla, int m, int max_steps, const T& offset2) {
+    const int start = m - 1;
+    const int levels = static_cast<int>(bla.size());
+    int k = -1;
+    while (k + 1 < levels && (start & ((2 << (k + 1)) - 1)) == 0)
+        k++;
+    for (; k >= 0; k--) {
+        const size_t j = static_cast<size_t>(start >> (k + 1));
+        if (j < bla[k].size() && (2 << k) <= max_steps && offset2 < bla[k][j].radius2)
+            return &bla[k][j];
+    }
+    return nullptr;
+}
+
+// Escape time loop on the offset d = z - Z of each pixel from the reference orbit Z.
+// Glitches, where d grows as large as z and loses the precision of the reference, are
+// avoided by rebasing: once |z| < |d| or the reference has escaped, the pixel continues
+// with d = z from the start of the orbit, where Z is 0.
+// Where the skip table has a valid step the pixel jumps over its iterations at once. An
+// escape that only shows after such a jump is counted at the last skipped iteration.
+// Real is double, or FloatExp for views deeper than double reaches. Such a jump counts as
+// one of the iterations the kernel ran.
+template<class Formula, class Real>
+static int64_t iterateSpanPerturbed(const KernelParams& params, const PixelSpan& span, int* iterations) {
+    const double* ref_re = params.reference->re.data();
+    const double* ref_im = params.reference->im.data();
+    const vector<vector<BlaStep<Real>>>& bla = blaSteps(*params.bla, Real());
+    const int last = static_cast<int>(params.reference->re.size()) - 1;
+    int64_t ran = 0;
+    for (int i = 0; i < span.count; i++) {
+        Real dc_re, dc_im;
+        makeOffset(dc_re, params.min_real_x + params.range_real_x * (span.x + i * span.dx) / params.width,
+                   params.offset_exponent);
+        makeOffset(dc_im, params.min_im_y + params.range_im_y * (span.y + i * span.dy) / params.height,
+                   params.offset_exponent);
+        Real d_re(0.0), d_im(0.0);
+        double re = 0, im = 0;
+        int m = 0;
+        int current_iteration = 0;
+        while (current_iteration < params.max_iterations) {
+            const BlaStep<Real>* skip = bla.empty() ? nullptr :
+                findBla(bla, m, params.max_iterations - current_iteration, d_re * d_re + d_im * d_im);
+            int steps = 1;
+            ran++;
+            if (skip != nullptr) {
+                steps = skip->length;
+                Real tmp = skip->a_re * d_re - skip->a_im * d_im + skip->b_re * dc_re - skip->b_im * dc_im;
+                d_im = skip->a_re * d_im + skip->a_im * d_re + skip->b_re * dc_im + skip->b_im * dc_re;
+                d_re = tmp;
+            } else {
+                Formula::perturbedStep(Real(ref_re[m]), Real(ref_im[m]), d_re, d_im, dc_re, dc_im);
+            }
+            m += steps;
+            const double offset_re = toDouble(d_re);
+            const double offset_im = toDouble(d_im);
+            re = ref_re[m] + offset_re;
+            im = ref_im[m] + offset_im;
+            double magnitude = re * re + im * im;
+            if (magnitude > 4) {
+                current_iteration += steps - 1;
+                break;
+            }
+            current_iteration += steps;
+            if (magnitude < offset_re * offset_re + offset_im * offset_im || m == last) {
+                d_re = Real(re);
+                d_im = Real(im);
+                m = 0;
+            }
+        }
+        iterations[i * span.stride] = current_iteration;
+    }
+    return ran;
+}
+
+template<class Real>
+static SpanKernel selectPerturbationKernel(FractalTypes type) {
+    switch (type) {
+        case FractalTypes::mandelbrot:
+            return iterateSpanPerturbed<MandelbrotFormula, Real>;
+        case FractalTypes::tricorn:
+            return iterateSpanPerturbed<TricornFormula, Real>;
+        case FractalTypes::burning_ship:
+            return iterateSpanPerturbed<BurningShipFormula, Real>;
+        default:
+            return nullptr;
+    }
+}
+
+SpanKernel selectPerturbationKernel(FractalTypes type, bool extended) {
+    if (extended)
+        return selectPerturbationKernel<FloatExp>(type);
+    return selectPerturbationKernel<double>(type);
+}
@@ -0,0 +1,60 @@
+#ifndef FRACTALVIEWER_PERTURBATION_H
+#define FRACTALVIEWER_PERTURBATION_H
+
+#include <vector>
+#include "Kernel.h"
+#include "BigFixed.h"
+using namespace std;
+
+// Orbit of a single point computed in arbitrary precision. Every other pixel is iterated
+// as a small offset from it, which double resolves far past the depth where the
+// coordinates themselves stop being representable. The orbit itself is stored in double
+// since its values stay in the order of the escape radius.
+//
+// Close to the reference the offset evolves linearly, d -> A * d + B * dc, and a table of
+// those maps lets a pixel skip whole blocks of iterations (bivariate linear approximation).
+// Level k of the table holds the maps over length = 2^(k+1) iterations starting at
+// 1 + j * length, each one only valid while |d| stays below its radius. Views deeper than
+// double reaches keep the table in FloatExp instead.
+template<class T>
+struct BlaStep {
+    T a_re, a_im;
+    T b_re, b_im;
+    T radius2;
+    int length;
+};
+
+// The radii depend on the largest offset of the view, so the table belongs to the view and
+// not to the orbit, which the reference cache shares between views.
+struct BlaTable {
+    vector<vector<BlaStep<double>>> steps;
+    vector<vector<BlaStep<FloatExp>>> extended_steps;
+};
+
+struct ReferenceOrbit {
+    vector<double> re;
+    vector<double> im;
+    // Full precision z where the orbit stopped, so it can be extended to more iterations.
+    BigFixed last_re;
+    BigFixed last_im;
+    bool escaped;
+};
+
+void computeReferenceOrbit(ReferenceOrbit& orbit, FractalTypes type, const BigFixed& center_re,
+                           const BigFixed& center_im, int max_iterations);
+
+// Continues an orbit of the same point up to max_iterations unless it escaped already.
+void extendReferenceOrbit(ReferenceOrbit& orbit, FractalTypes type, const BigFixed& center_re,
+                          const BigFixed& center_im, int max_iterations);
+
+// Builds the skip table of the orbit for offsets dc up to max_offset, in FloatExp for the
+// extended kernels. Only the Mandelbrot set gets one. Tricorn and burning ship conjugate or
+// fold the offset, which a complex A can't express, so their pixels iterate every step.
+void computeBlaTable(BlaTable& table, const ReferenceOrbit& orbit, FractalTypes type, const FloatExp& max_offset,
+                     bool extended);
+
+// Returns nullptr for formulas that can't be perturbed. The extended kernels keep the offsets
+// in FloatExp.
+SpanKernel selectPerturbationKernel(FractalTypes type, bool extended);
+
+#endif //FRACTALVIEWER_PERTURBATION_H
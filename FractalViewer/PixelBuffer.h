@@ -0,0 +1,45 @@
+#ifndef FRACTALVIEWER_PIXELBUFFER_H
+#define FRACTALVIEWER_PIXELBUFFER_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+// RGBA8 image the renderer writes into directly. Rows are packed without padding, so the
+// pixels can be uploaded to a texture as they are, without going through an image class.
+// The pixels are stored as one 32 bit word each, in the byte order of RGBA, and the first one
+// is aligned to a cache line for the vectorized coloring.
+class PixelBuffer {
+    static const size_t alignment = 64 / sizeof(uint32_t);
+    vector<uint32_t> storage;
+    uint32_t* pixels;
+    int width;
+    int height;
+
+public:
+    PixelBuffer() : pixels(nullptr), width(0), height(0) {}
+    // The pixels point into the own storage, copies would share it.
+    PixelBuffer(const PixelBuffer&) = delete;
+    PixelBuffer& operator=(const PixelBuffer&) = delete;
+
+    // Resizes the buffer to opaque black.
+    void create(int newWidth, int newHeight) {
+        const uint8_t black[4] = {0, 0, 0, 255};
+        uint32_t packed;
+        memcpy(&packed, black, sizeof(packed));
+        storage.assign(static_cast<size_t>(newWidth) * newHeight + alignment - 1, packed);
+        const size_t misalignment = reinterpret_cast<uintptr_t>(storage.data()) / sizeof(uint32_t) % alignment;
+        pixels = storage.data() + (misalignment == 0 ? 0 : alignment - misalignment);
+        width = newWidth;
+        height = newHeight;
+    }
+
+    uint8_t* getPixels() { return reinterpret_cast<uint8_t*>(pixels); }
+    const uint8_t* getPixels() const { return reinterpret_cast<const uint8_t*>(pixels); }
+    uint32_t* getPackedPixels() { return pixels; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+};
+
+#endif //FRACTALVIEWER_PIXELBUFFER_H
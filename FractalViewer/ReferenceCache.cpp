@@ -0,0 +1,51 @@
+#include "ReferenceCache.h"
+
+
+ReferenceCache::ReferenceCache() {
+    this->use_counter = 0;
+}
+
+bool ReferenceCache::matches(const Entry& entry, FractalTypes type, const BigFixed& center_re,
+                             const BigFixed& center_im) {
+    const int limbs = center_re.getLimbs();
+    if (entry.type != type || entry.center_re.getLimbs() < limbs)
+        return false;
+    BigFixed cut_re = entry.center_re;
+    BigFixed cut_im = entry.center_im;
+    cut_re.setLimbs(limbs);
+    cut_im.setLimbs(limbs);
+    return cut_re == center_re && cut_im == center_im;
+}
+
+// Returns the orbit of the center with at least max_iterations steps unless it escapes earlier.
+// Misses compute the orbit and replace the least recently used entry.
+shared_ptr<ReferenceOrbit> ReferenceCache::find(FractalTypes type, const BigFixed& center_re,
+                                                const BigFixed& center_im, int max_iterations) {
+    use_counter++;
+    for (Entry& entry : entries) {
+        if (!matches(entry, type, center_re, center_im))
+            continue;
+        entry.last_use = use_counter;
+        // The orbit is continued at the precision it was started with. Copies of the fractal
+        // may still render with the shorter one, so it is extended as a copy.
+        if (!entry.orbit->escaped && static_cast<int>(entry.orbit->re.size()) <= max_iterations) {
+            shared_ptr<ReferenceOrbit> extended = make_shared<ReferenceOrbit>(*entry.orbit);
+            extendReferenceOrbit(*extended, type, entry.center_re, entry.center_im, max_iterations);
+            entry.orbit = extended;
+        }
+        return entry.orbit;
+    }
+    Entry entry = { type, center_re, center_im, make_shared<ReferenceOrbit>(), use_counter };
+    computeReferenceOrbit(*entry.orbit, type, center_re, center_im, max_iterations);
+    if (entries.size() < capacity) {
+        entries.push_back(entry);
+    } else {
+        size_t oldest = 0;
+        for (size_t i = 1; i < entries.size(); i++) {
+            if (entries[i].last_use < entries[oldest].last_use)
+                oldest = i;
+        }
+        entries[oldest] = entry;
+    }
+    return entry.orbit;
+}
@@ -0,0 +1,36 @@
+#ifndef FRACTALVIEWER_REFERENCECACHE_H
+#define FRACTALVIEWER_REFERENCECACHE_H
+
+#include <memory>
+#include <vector>
+#include "BigFixed.h"
+#include "FractalTypes.h"
+#include "Perturbation.h"
+using namespace std;
+
+// Reference orbits of the last few perturbation views. Zooming into the center or animating
+// out of it keeps the reference point, so its orbit is computed once and reused.
+// An entry serves a view of the same fractal whose center equals the entry's center cut to
+// the precision of the view. Deeper entries carry more bits and serve shallower views as
+// well, the bits they have in excess lie below the guard bits of those views.
+// Orbits that stopped short of the requested iterations without escaping are extended.
+class ReferenceCache {
+    struct Entry {
+        FractalTypes type;
+        BigFixed center_re;
+        BigFixed center_im;
+        shared_ptr<ReferenceOrbit> orbit;
+        unsigned long last_use;
+    };
+    vector<Entry> entries;
+    unsigned long use_counter;
+    static const size_t capacity = 4;
+    static bool matches(const Entry& entry, FractalTypes type, const BigFixed& center_re, const BigFixed& center_im);
+
+public:
+    ReferenceCache();
+    shared_ptr<ReferenceOrbit> find(FractalTypes type, const BigFixed& center_re, const BigFixed& center_im,
+                                    int max_iterations);
+};
+
+#endif //FRACTALVIEWER_REFERENCECACHE_H
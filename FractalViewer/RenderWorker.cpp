@@ -0,0 +1,126 @@
+#include "RenderWorker.h"
+
+
+RenderWorker::RenderWorker(const Fractal& view, int width, int height)
+        : fractal(view), pending(view), cancel(false) {
+    this->width = width;
+    this->height = height;
+    this->front = 0;
+    this->pending_time = 0;
+    this->has_pending = false;
+    this->rendering = false;
+    this->refining = false;
+    this->frame_ready = false;
+    this->stop = false;
+    this->frame_iterations = view.getIterations();
+    this->frame_time = 0;
+    this->submitted_view_version = 0;
+    this->submitted_palette_version = 0;
+    this->submitted_time = 0;
+    images[0].create(width, height);
+    images[1].create(width, height);
+    fractal.setCancelFlag(&cancel);
+    fractal.setProgressive(true);
+    worker = thread(&RenderWorker::run, this);
+}
+
+RenderWorker::~RenderWorker() {
+    {
+        lock_guard<mutex> lock(state_mutex);
+        stop = true;
+        cancel = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+// Hands the current view to the worker. Nothing happens if it was already submitted.
+// Only view changes cancel the frame in flight, a palette change still reuses its iterations.
+void RenderWorker::submit(const Fractal& view, double time_delta) {
+    bool view_changed = view.getViewVersion() != submitted_view_version ||
+                        (view.isAnimated() && time_delta != submitted_time);
+    if (!view_changed && view.getPaletteVersion() == submitted_palette_version)
+        return;
+    submitted_view_version = view.getViewVersion();
+    submitted_palette_version = view.getPaletteVersion();
+    submitted_time = time_delta;
+    {
+        lock_guard<mutex> lock(state_mutex);
+        pending = view;
+        pending_time = time_delta;
+        has_pending = true;
+        if (view_changed && rendering)
+            cancel = true;
+    }
+    wake.notify_one();
+}
+
+// Uploads the newest finished frame to the texture. Returns false if there is none.
+// The texture is created on the first frame, after that the pixels are copied straight into it.
+bool RenderWorker::takeFrame(Texture& texture) {
+    lock_guard<mutex> lock(state_mutex);
+    if (!frame_ready)
+        return false;
+    if (texture.getSize().x != static_cast<unsigned int>(width) || texture.getSize().y != static_cast<unsigned int>(height))
+        texture.create(width, height);
+    texture.update(images[front].getPixels());
+    frame_ready = false;
+    return true;
+}
+
+// True if the last frame is complete and was taken.
+bool RenderWorker::isIdle() {
+    lock_guard<mutex> lock(state_mutex);
+    return !has_pending && !rendering && !refining && !frame_ready;
+}
+
+int RenderWorker::getIterations() {
+    lock_guard<mutex> lock(state_mutex);
+    return frame_iterations;
+}
+
+float RenderWorker::getFrameTime() {
+    lock_guard<mutex> lock(state_mutex);
+    return frame_time;
+}
+
+// Worker thread. Renders the latest submitted view into the back image and swaps it to the front.
+// Progressive passes are published one by one. New input is picked up between passes,
+// so a coarse frame of the new view shows up without waiting for the old one to finish.
+void RenderWorker::run() {
+    unique_lock<mutex> lock(state_mutex);
+    double time_delta = 0;
+    Clock frame_clock;
+    while (true) {
+        wake.wait(lock, [this] { return stop || has_pending || refining; });
+        if (stop)
+            return;
+        if (has_pending) {
+            if (fractal.getViewVersion() != pending.getViewVersion() || time_delta != pending_time)
+                frame_clock.restart();
+            fractal.syncView(pending);
+            time_delta = pending_time;
+            has_pending = false;
+        }
+        rendering = true;
+        cancel = false;
+        int back = 1 - front;
+        lock.unlock();
+
+        fractal.setImage(&images[back]);
+        bool rendered = fractal.renderFractal(width, height, time_delta);
+        bool more_passes = fractal.needsRender(width, height, time_delta);
+
+        lock.lock();
+        rendering = false;
+        refining = false;
+        if (rendered && !cancel) {
+            front = back;
+            frame_ready = true;
+            frame_iterations = fractal.getIterations();
+            refining = more_passes;
+            if (!more_passes)
+                frame_time = frame_clock.getElapsedTime().asSeconds();
+        }
+    }
+}
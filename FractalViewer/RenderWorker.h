@@ -0,0 +1,51 @@
+#ifndef FRACTALVIEWER_RENDERWORKER_H
+#define FRACTALVIEWER_RENDERWORKER_H
+
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "Fractal.h"
+using namespace std;
+using namespace sf;
+
+// Renders the fractal on its own thread so the window keeps handling events during slow frames.
+// Frames are rendered into the back image and swapped with the front image once finished.
+// A view change cancels the frame in flight and starts over with the new view.
+// Frames are rendered progressively and every pass is published.
+class RenderWorker {
+    Fractal fractal;
+    PixelBuffer images[2];
+    int front;
+    int width;
+    int height;
+    Fractal pending;
+    double pending_time;
+    bool has_pending;
+    bool rendering;
+    bool refining;
+    bool frame_ready;
+    bool stop;
+    int frame_iterations;
+    float frame_time;
+    unsigned long submitted_view_version;
+    unsigned long submitted_palette_version;
+    double submitted_time;
+    atomic<bool> cancel;
+    mutex state_mutex;
+    condition_variable wake;
+    thread worker;
+    void run();
+
+public:
+    RenderWorker(const Fractal& view, int width, int height);
+    ~RenderWorker();
+    void submit(const Fractal& view, double time_delta);
+    bool takeFrame(Texture& texture);
+    bool isIdle();
+    int getIterations();
+    float getFrameTime();
+};
+
+#endif //FRACTALVIEWER_RENDERWORKER_H
@@ -9,6 +9,7 @@
 #include <climits>
 #include "ArialFont.h"
 #include "Fractal.h"
+#include "RenderWorker.h"
 using namespace std;
 using namespace sf;
 
@@ -18,7 +19,7 @@ struct WindowSettings{
 };
 
 // Color palettes
-vector<Color> gradient_ultra_fractal{
+vector<PaletteColor> gradient_ultra_fractal{
 	{0,0,0},
 	{0,7,100},
 	{32,107,203},
@@ -30,10 +31,10 @@ vector<Color> gradient_ultra_fractal{
 // Functions
 void screenZoom(WindowSettings windowSettings, Fractal* fractal, tuple<int, int> cursorPos, double factor, bool zoomCenter);
 void screenshot(Texture& texture, bool isAnimation);
-void highResolutionScreenshot(Fractal* old_fractal, vector<Color>& cols, int winWidth, float aspectRatio);
-void saveColors(vector<Color>& colors);
+void highResolutionScreenshot(Fractal* old_fractal, int winWidth, float aspectRatio);
+void saveColors(vector<PaletteColor>& colors);
 struct tm* getLocalTimeInfo();
-vector<Color> getRandomColors(int amount);
+vector<PaletteColor> getRandomColors(int amount);
 
 
 int main(int argc, char *argv[])
@@ -72,7 +73,7 @@ int main(int argc, char *argv[])
     // Fractal Settings
     float escape_radius = 1000;
     int max_colors = 2000;
-    vector<Color> colors = gradient_ultra_fractal;
+    vector<PaletteColor> colors = gradient_ultra_fractal;
 
     // Don't touch
     double zoom_val = 1;
@@ -81,26 +82,29 @@ int main(int argc, char *argv[])
     bool dragging = false;
     srand(time(nullptr));
     WindowSettings window_size = {win_width, win_height};
-    Image img;
+    // Keyboard moves are rounded to whole pixels, so the part of the frame still in view is reused.
+    const double move_x = round(move_factor * window_size.width) / window_size.width;
+    const double move_y = round(move_factor * window_size.height) / window_size.height;
     Texture texture;
     Sprite sprite;
     Font font;
     Text text;
-    Clock clock;
     Clock clock_anim;
     Event event{};
     Vector2i prev_drag;
 
 	// Colors are saved in another vector so you get the same colors if you change the amount.
-	vector<Color> extra_random_colors = colors;
-	vector<Color> temp = getRandomColors(max_colors - colors.size());
+	vector<PaletteColor> extra_random_colors = colors;
+	vector<PaletteColor> temp = getRandomColors(max_colors - colors.size());
 	extra_random_colors.insert(extra_random_colors.end(), temp.begin(), temp.end());
 	temp.clear();
 
 	// Create Window, Font and Fractal
 	RenderWindow window(VideoMode(window_size.width, window_size.height), "Fractal Viewer");
-	img.create(window_size.width, window_size.height);
-    auto fractal = new Fractal(&img, dynamic_iterations, escape_radius);
+    // This fractal only holds the view, the worker renders a copy of it on its own thread.
+    auto fractal = new Fractal(nullptr, dynamic_iterations, escape_radius);
+    fractal->setColors(colors);
+    RenderWorker worker(*fractal, window_size.width, window_size.height);
 
 	if (!font.loadFromMemory(&arial_ttf, arial_ttf_len))
 	{
@@ -112,42 +116,33 @@ int main(int argc, char *argv[])
 	text.setFillColor(Color::White);
 
 	// Game Loop
+	bool idle = false;
 	while (window.isOpen()) {
-		while (window.pollEvent(event)) {
+		// Without input there is nothing new to render, so block until the next event instead of spinning.
+		bool has_event = idle ? window.waitEvent(event) : window.pollEvent(event);
+		for (; has_event; has_event = window.pollEvent(event)) {
 			if (event.type == Event::Closed) {
 				window.close();
 			}
 
 			if (event.type == Event::KeyPressed) {
 				// Moving around with WASD
-				bool changed_frac_settings = false;
-				auto p_fractal = fractal->getFracSettings();
-				double width_step = (p_fractal.max_real_x - p_fractal.min_real_x) * move_factor;
-				double height_step = (p_fractal.max_im_y - p_fractal.min_im_y) * move_factor;
                 switch (event.key.code) {
 				    case Keyboard::W:
 				        // Move Up
-                        p_fractal.min_im_y -= height_step;
-                        p_fractal.max_im_y -= height_step;
-                        changed_frac_settings = true;
+                        fractal->moveView(0, -move_y);
 				        break;
                     case Keyboard::A:
                         // Move Left
-                        p_fractal.min_real_x -= width_step;
-                        p_fractal.max_real_x -= width_step;
-                        changed_frac_settings = true;
+                        fractal->moveView(-move_x, 0);
                         break;
                     case Keyboard::S:
                         // Move Down
-                        p_fractal.min_im_y += height_step;
-                        p_fractal.max_im_y += height_step;
-                        changed_frac_settings = true;
+                        fractal->moveView(0, move_y);
                         break;
                     case Keyboard::D:
                         // Move Right
-                        p_fractal.min_real_x += width_step;
-                        p_fractal.max_real_x += width_step;
-                        changed_frac_settings = true;
+                        fractal->moveView(move_x, 0);
                         break;
                     case Keyboard::Num1:
                         // Change to Mandelbrot
@@ -178,6 +173,7 @@ int main(int argc, char *argv[])
                         // Increase Color Count
                         if (colors.size() < extra_random_colors.size())
                             colors.push_back(extra_random_colors.at(colors.size()));
+                        fractal->setColors(colors);
                         break;
                     case Keyboard::Down:
                         // Decrease Color Count
@@ -187,6 +183,7 @@ int main(int argc, char *argv[])
                         else {
                             colors.push_back(extra_random_colors.at(colors.size()));
                         }
+                        fractal->setColors(colors);
                         break;
                     case Keyboard::Left:
                         // Slow Down Animation
@@ -201,6 +198,7 @@ int main(int argc, char *argv[])
                     case Keyboard::Space:
                         // Create New Random Colors
                         colors = getRandomColors(colors.size());
+                        fractal->setColors(colors);
                         break;
                     case Keyboard::Enter:
                         // Print Current Colors
@@ -212,7 +210,7 @@ int main(int argc, char *argv[])
                         break;
                     case Keyboard::T:
                         // Screenshot Screen
-                        highResolutionScreenshot(fractal, colors, highResScreenshotSize, aspect_ratio);
+                        highResolutionScreenshot(fractal, highResScreenshotSize, aspect_ratio);
                         break;
                     case Keyboard::Z:
                         // Screenshot Animation While Zooming Out
@@ -227,11 +225,16 @@ int main(int argc, char *argv[])
                         // Toggle Iteration Mode (Dynamic - Manual)
                         fractal->toggleIterationMode();
                         break;
+                    case Keyboard::M:
+                        // Toggle Render Method (Subdivision - Per Pixel)
+                        if (fractal->getRenderMethod() == RenderMethod::subdivision)
+                            fractal->setRenderMethod(RenderMethod::per_pixel);
+                        else
+                            fractal->setRenderMethod(RenderMethod::subdivision);
+                        break;
                     default:
                         break;
                 }
-                if (changed_frac_settings)
-                    fractal->setFracSettings(p_fractal);
 			}
 
 			if (event.type == Event::MouseButtonPressed) {
@@ -267,17 +270,10 @@ int main(int argc, char *argv[])
 			if (event.type == sf::Event::MouseMoved) {
 			    // Dragging Action
 				if (dragging) {
-                    auto p_fractal = fractal->getFracSettings();
-					double drag_factor = 1 / (double(win_height)*aspect_ratio);
 					Vector2i curDrag = { event.mouseMove.x, event.mouseMove.y };
-					double step = (p_fractal.max_real_x - p_fractal.min_real_x) * drag_factor;
-					double re_x_movement = ((double)prev_drag.x - (double)curDrag.x) * step;
-					double im_y_movement = ((double)prev_drag.y - (double)curDrag.y) * step;
-                    p_fractal.min_real_x += re_x_movement;
-                    p_fractal.max_real_x += re_x_movement;
-                    p_fractal.min_im_y += im_y_movement;
-                    p_fractal.max_im_y += im_y_movement;
-                    fractal->setFracSettings(p_fractal);
+					double re_x_movement = ((double)prev_drag.x - (double)curDrag.x) / window_size.width;
+					double im_y_movement = ((double)prev_drag.y - (double)curDrag.y) / window_size.height;
+                    fractal->moveView(re_x_movement, im_y_movement);
 					prev_drag = curDrag;
 				}
 			}
@@ -300,23 +296,26 @@ int main(int argc, char *argv[])
 		}
 
 		window.clear();
-		fractal->renderFractal(colors, window_size.width, window_size.height, time_d);
-		texture.loadFromImage(img);
-		sprite.setTexture(texture);
+		worker.submit(*fractal, time_d);
+		bool new_frame = worker.takeFrame(texture);
+		if (new_frame)
+			sprite.setTexture(texture);
 		window.draw(sprite);
-		int frac_type = (int)fractal->getFractalType();
 		if (show_sys_info) {
-			float time_per_frame = clock.getElapsedTime().asSeconds();
-			clock.restart();
-			char buff[100];
+			char buff[256];
 			snprintf(buff, sizeof(buff),
             "Fractal: %s\n"
 				"Iterations: %d\n"
 				"Zoom: x%2.2lf\n"
-				"Time per frame: %0.5lf\n",
+				"Time per frame: %0.5lf\n"
+				"Kernel: %s\n"
+				"Precision: %s\n"
+				"Method: %s\n",
 				fractal->getName(),
-				fractal->getIterations(), zoom_val,
-				time_per_frame);
+				worker.getIterations(), zoom_val,
+				worker.getFrameTime(), fractal->getKernelName(window_size.width),
+				fractal->getPrecisionName(window_size.width),
+				fractal->getRenderMethod() == RenderMethod::subdivision ? "Subdivision" : "Per Pixel");
 			text.setString(buff);
 		}
 		window.draw(text);
@@ -325,7 +324,8 @@ int main(int argc, char *argv[])
 			time_d += 0.05;
 			clock_anim.restart();
 		}
-		if (screenshot_zoom) {
+		// Every step of the zoom animation waits for its finished frame.
+		if (screenshot_zoom && worker.isIdle()) {
 			screenshot(texture, true);
 			screenZoom(window_size, fractal, {event.mouseWheelScroll.x, event.mouseWheelScroll.y}, screenshot_zoom_fact,
                        true);
@@ -334,6 +334,11 @@ int main(int argc, char *argv[])
 				screenshot_zoom = false;
 			}
 		}
+		idle = !screenshot_zoom && !fractal->isAnimated() && worker.isIdle();
+		if (!idle && !new_frame) {
+			// Waiting for the worker or the animation clock, don't spin in the meantime.
+			sleep(milliseconds(1));
+		}
 	}
 	return 0;
 }
@@ -341,27 +346,14 @@ int main(int argc, char *argv[])
 // Function zooms into the Mandelbrot set either following the cursor or in the center.
 void screenZoom(WindowSettings windowSettings, Fractal* fractal, tuple<int, int> cursorPos, double factor, bool zoomCenter)
 {
-    auto p_fractal = fractal->getFracSettings();
-	double zoom_to_x = 0;
-	double zoom_to_y = 0;
-	if (zoomCenter) {
-		zoom_to_x = p_fractal.min_real_x + (p_fractal.max_real_x - p_fractal.min_real_x) * (windowSettings.width / 2.0) / windowSettings.width;
-		zoom_to_y = p_fractal.min_im_y + (p_fractal.max_im_y - p_fractal.min_im_y) * (windowSettings.height / 2.0) / windowSettings.height;
-		}
-	else {
-		zoom_to_x = p_fractal.min_real_x + (p_fractal.max_real_x - p_fractal.min_real_x) * get<0>(cursorPos) / windowSettings.width;
-		zoom_to_y = p_fractal.min_im_y + (p_fractal.max_im_y - p_fractal.min_im_y) * get<1>(cursorPos) / windowSettings.height;
+	double zoom_to_x = 0.5;
+	double zoom_to_y = 0.5;
+	if (!zoomCenter) {
+		zoom_to_x = static_cast<double>(get<0>(cursorPos)) / windowSettings.width;
+		zoom_to_y = static_cast<double>(get<1>(cursorPos)) / windowSettings.height;
 	}
-
-	double new_min_real = zoom_to_x - (p_fractal.max_real_x - p_fractal.min_real_x) / 2 / factor;
-    p_fractal.max_real_x = zoom_to_x + (p_fractal.max_real_x - p_fractal.min_real_x) / 2 / factor;
-    p_fractal.min_real_x = new_min_real;
-
-	double new_min_im = zoom_to_y - (p_fractal.max_im_y - p_fractal.min_im_y) / 2 / factor;
-    p_fractal.max_im_y = zoom_to_y + (p_fractal.max_im_y - p_fractal.min_im_y) / 2 / factor;
-    p_fractal.min_im_y = new_min_im;
-
-    fractal->setFracSettings(p_fractal);
+    // The fractal keeps the center in extended precision, so zooming works on fractions of the view.
+    fractal->zoomView(zoom_to_x, zoom_to_y, factor);
 }
 
 struct tm* getLocalTimeInfo() {
@@ -386,11 +378,11 @@ void screenshot(Texture& texture, bool isAnimation) {
 }
 
 // Spawns a new Window with a given resolution, takes a high resoltion screenshot and closes the window.
-void highResolutionScreenshot(Fractal* mainFractal, vector<Color>& cols, int winWidth, float aspectRatio) {
+void highResolutionScreenshot(Fractal* mainFractal, int winWidth, float aspectRatio) {
     int width = winWidth;
     int height = static_cast<int>(width / aspectRatio);
 
-    Image local_img;
+    PixelBuffer local_img;
     Texture local_texture;
     Sprite local_sprite;
     RenderWindow local_window(VideoMode(width, height), "HR Screenshot");
@@ -398,8 +390,9 @@ void highResolutionScreenshot(Fractal* mainFractal, vector<Color>& cols, int win
 
     local_img.create(width, height);
     local_fractal.setImage(&local_img);
-    local_fractal.renderFractal(cols, width, height, 0);
-    local_texture.loadFromImage(local_img);
+    local_fractal.renderFractal(width, height, 0);
+    local_texture.create(width, height);
+    local_texture.update(local_img.getPixels());
     local_sprite.setTexture(local_texture);
     local_window.draw(local_sprite);
     local_window.display();
@@ -410,8 +403,8 @@ void highResolutionScreenshot(Fractal* mainFractal, vector<Color>& cols, int win
 }
 
 // Returns an array of n random colors.
-vector<Color> getRandomColors(int amount) {
-	vector<Color> temp;
+vector<PaletteColor> getRandomColors(int amount) {
+	vector<PaletteColor> temp;
 	temp.emplace_back(0, 0, 0);
 	for (int i = 0; i < amount - 1; i++) {
 		temp.emplace_back(rand() % 255, rand() % 255, rand() % 255);
@@ -420,9 +413,9 @@ vector<Color> getRandomColors(int amount) {
 }
 
 // Prints the currently selected colors to the console.
-void saveColors(vector<Color>& colors) {
-	cout << "vector<Color> saved_grad{" << endl;
-	for (Color col : colors)
+void saveColors(vector<PaletteColor>& colors) {
+	cout << "vector<PaletteColor> saved_grad{" << endl;
+	for (PaletteColor col : colors)
 		cout << "\t{" << (int)col.r << ", " << (int)col.g << ", " << (int)col.b << " } " << endl;
 	cout << "};" << endl;
 }
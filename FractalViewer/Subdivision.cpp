@@ -0,0 +1,105 @@
+#include "Subdivision.h"
+#include <cstddef>
+
+// Rectangles this thin are computed pixel by pixel instead of being split further.
+static const int min_subdivision_size = 15;
+
+// Computes the pixels x0..x1 of row y, skipping samples left over from the previous pass.
+static int64_t computeRow(const SubdivisionContext& context, int y, int x0, int x1) {
+    if (context.refine && y % 2 == 0)
+        x0 |= 1;
+    if (x1 < x0)
+        return 0;
+    int step = context.refine && y % 2 == 0 ? 2 : 1;
+    PixelSpan span = { x0, y, step, 0, (x1 - x0) / step + 1, step };
+    size_t offset = static_cast<size_t>(y) * context.params.width + x0;
+    return context.kernel(context.params, span, &context.iterations[offset]);
+}
+
+// Computes the pixels y0..y1 of column x, skipping samples left over from the previous pass.
+static int64_t computeColumn(const SubdivisionContext& context, int x, int y0, int y1) {
+    if (context.refine && x % 2 == 0)
+        y0 |= 1;
+    if (y1 < y0)
+        return 0;
+    int step = context.refine && x % 2 == 0 ? 2 : 1;
+    int width = context.params.width;
+    PixelSpan span = { x, y0, 0, step, (y1 - y0) / step + 1, step * width };
+    size_t offset = static_cast<size_t>(y0) * width + x;
+    return context.kernel(context.params, span, &context.iterations[offset]);
+}
+
+// Checks that the border and every sample inside that is already known have the same count.
+static bool isUniform(const SubdivisionContext& context, int x0, int y0, int x1, int y1) {
+    const int width = context.params.width;
+    const int* iterations = context.iterations;
+    const int value = iterations[static_cast<size_t>(y0) * width + x0];
+    for (int x = x0; x <= x1; x++) {
+        if (iterations[static_cast<size_t>(y0) * width + x] != value ||
+            iterations[static_cast<size_t>(y1) * width + x] != value)
+            return false;
+    }
+    for (int y = y0 + 1; y < y1; y++) {
+        if (iterations[static_cast<size_t>(y) * width + x0] != value ||
+            iterations[static_cast<size_t>(y) * width + x1] != value)
+            return false;
+    }
+    if (context.refine) {
+        for (int y = (y0 + 2) & ~1; y < y1; y += 2) {
+            for (int x = (x0 + 2) & ~1; x < x1; x += 2) {
+                if (iterations[static_cast<size_t>(y) * width + x] != value)
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Expects the border of the rectangle to be computed already.
+static int64_t subdivide(const SubdivisionContext& context, int x0, int y0, int x1, int y1) {
+    if (x1 - x0 < 2 || y1 - y0 < 2)
+        return 0;
+    const int width = context.params.width;
+    if (isUniform(context, x0, y0, x1, y1)) {
+        size_t corner = static_cast<size_t>(y0) * width + x0;
+        int value = context.iterations[corner];
+        for (int y = y0 + 1; y < y1; y++) {
+            for (int x = x0 + 1; x < x1; x++)
+                context.iterations[static_cast<size_t>(y) * width + x] = value;
+        }
+        return 0;
+    }
+    int64_t ran = 0;
+    if (x1 - x0 <= min_subdivision_size || y1 - y0 <= min_subdivision_size) {
+        for (int y = y0 + 1; y < y1; y++)
+            ran += computeRow(context, y, x0 + 1, x1 - 1);
+        return ran;
+    }
+    // Split the longer side. The new edge is the shared border of both halves.
+    if (x1 - x0 >= y1 - y0) {
+        int x_mid = (x0 + x1) / 2;
+        ran += computeColumn(context, x_mid, y0 + 1, y1 - 1);
+        ran += subdivide(context, x0, y0, x_mid, y1);
+        ran += subdivide(context, x_mid, y0, x1, y1);
+    }
+    else {
+        int y_mid = (y0 + y1) / 2;
+        ran += computeRow(context, y_mid, x0 + 1, x1 - 1);
+        ran += subdivide(context, x0, y0, x1, y_mid);
+        ran += subdivide(context, x0, y_mid, x1, y1);
+    }
+    return ran;
+}
+
+// Renders the rectangle x0..x1, y0..y1 (inclusive) with Mariani-Silver subdivision:
+// the border is iterated and if it has the same count everywhere the inside is filled,
+// otherwise the rectangle is split in two and each half is handled the same way.
+int64_t renderSubdivided(const SubdivisionContext& context, int x0, int y0, int x1, int y1) {
+    int64_t ran = computeRow(context, y0, x0, x1);
+    if (y1 > y0)
+        ran += computeRow(context, y1, x0, x1);
+    ran += computeColumn(context, x0, y0 + 1, y1 - 1);
+    if (x1 > x0)
+        ran += computeColumn(context, x1, y0 + 1, y1 - 1);
+    return ran + subdivide(context, x0, y0, x1, y1);
+}
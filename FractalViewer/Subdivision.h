@@ -0,0 +1,18 @@
+#ifndef FRACTALVIEWER_SUBDIVISION_H
+#define FRACTALVIEWER_SUBDIVISION_H
+
+#include "Kernel.h"
+
+// Everything the subdivision needs to compute pixels of one frame.
+// With refine set, the pixels with even x and y were computed by the previous progressive pass.
+struct SubdivisionContext {
+    SpanKernel kernel;
+    KernelParams params;
+    int* iterations;
+    bool refine;
+};
+
+// Returns the iterations the kernel ran.
+int64_t renderSubdivided(const SubdivisionContext& context, int x0, int y0, int x1, int y1);
+
+#endif //FRACTALVIEWER_SUBDIVISION_H
@@ -0,0 +1,100 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#endif
+
+// Polls before a worker parks or the caller yields. Long enough to cover the gap between
+// the passes of a frame, short compared to the time between frames.
+static const int spin_count = 1 << 14;
+
+// Lets the other hyperthread of the core run while spinning.
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#endif
+}
+
+ThreadPool::ThreadPool(int threads) : job(nullptr), generation(0), running(0) {
+    this->parked = 0;
+    this->stop = false;
+    for (int index = 1; index < threads; index++)
+        workers.emplace_back(&ThreadPool::work, this, index);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(park_mutex);
+        stop = true;
+        generation.fetch_add(1, memory_order_release);
+    }
+    wake.notify_all();
+    for (thread& worker : workers)
+        worker.join();
+}
+
+int ThreadPool::getThreadCount() const {
+    return static_cast<int>(workers.size()) + 1;
+}
+
+// Worker thread. Waits for the generation to change, spinning first and parking after that.
+void ThreadPool::work(int index) {
+    unsigned seen = 0;
+    while (true) {
+        unsigned current = generation.load(memory_order_acquire);
+        for (int spin = 0; current == seen && spin < spin_count; spin++) {
+            cpuRelax();
+            current = generation.load(memory_order_acquire);
+        }
+        if (current == seen) {
+            unique_lock<mutex> lock(park_mutex);
+            parked++;
+            wake.wait(lock, [this, seen] { return generation.load(memory_order_acquire) != seen; });
+            parked--;
+            current = generation.load(memory_order_acquire);
+        }
+        seen = current;
+        if (stop)
+            return;
+        (*job)(index);
+        running.fetch_sub(1, memory_order_release);
+    }
+}
+
+void ThreadPool::run(const function<void(int)>& job) {
+    lock_guard<mutex> lock(job_mutex);
+    if (workers.empty()) {
+        job(0);
+        return;
+    }
+    this->job = &job;
+    running.store(static_cast<int>(workers.size()), memory_order_relaxed);
+    {
+        lock_guard<mutex> park_lock(park_mutex);
+        generation.fetch_add(1, memory_order_release);
+        if (parked > 0)
+            wake.notify_all();
+    }
+    job(0);
+    // Frame barrier. The tiles keep every thread busy until close to the end, so the
+    // others are usually done by the time the caller gets here.
+    for (int spin = 0; running.load(memory_order_acquire) != 0; spin++) {
+        if (spin < spin_count)
+            cpuRelax();
+        else
+            this_thread::yield();
+    }
+}
+
+void ThreadPool::parallelFor(int count, const function<void(int)>& body) {
+    atomic<int> next(0);
+    run([&next, count, &body](int) {
+        for (int i = next.fetch_add(1, memory_order_relaxed); i < count; i = next.fetch_add(1, memory_order_relaxed))
+            body(i);
+    });
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(max(1, static_cast<int>(thread::hardware_concurrency())));
+    return pool;
+}
@@ -0,0 +1,43 @@
+#ifndef FRACTALVIEWER_THREADPOOL_H
+#define FRACTALVIEWER_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Render threads that live as long as the program. Starting a job only bumps a counter the
+// idle workers are spinning on, which is far cheaper than creating or waking a thread team
+// for every pass of a small frame. Workers that find no job for a while park on a condition
+// variable so an idle viewer doesn't keep the cores busy.
+// Jobs from different threads, like the render worker and a high resolution screenshot,
+// are run one after the other.
+class ThreadPool {
+    vector<thread> workers;
+    mutex job_mutex;
+    mutex park_mutex;
+    condition_variable wake;
+    const function<void(int)>* job;
+    atomic<unsigned> generation;
+    atomic<int> running;
+    int parked;
+    bool stop;
+    void work(int index);
+
+public:
+    // threads counts the calling thread, which takes part in every job.
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+    int getThreadCount() const;
+    // Runs job(index) once on every thread, index 0 being the caller, and returns once all are done.
+    void run(const function<void(int)>& job);
+    // Runs body(i) for every i in [0, count), handing out the indices to whichever thread is free.
+    void parallelFor(int count, const function<void(int)>& body);
+    // Pool with a thread for every core, shared by all renders.
+    static ThreadPool& shared();
+};
+
+#endif //FRACTALVIEWER_THREADPOOL_H
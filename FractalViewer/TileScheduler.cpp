@@ -0,0 +1,69 @@
+#include "TileScheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+// Tiles of one thread. front and back are packed into one word, the owner takes from the
+// front and thieves from the back, both with a compare and swap.
+struct TileQueue {
+    vector<int> tiles;
+    atomic<uint64_t> range;
+};
+
+static inline uint64_t packRange(uint32_t front, uint32_t back) {
+    return (static_cast<uint64_t>(front) << 32) | back;
+}
+
+// Takes a tile from the front, or from the back when stealing. Returns -1 if the queue is empty.
+static int takeTile(TileQueue& queue, bool steal) {
+    uint64_t range = queue.range.load(memory_order_relaxed);
+    while (true) {
+        uint32_t front = static_cast<uint32_t>(range >> 32);
+        uint32_t back = static_cast<uint32_t>(range);
+        if (front >= back)
+            return -1;
+        uint64_t next = steal ? packRange(front, back - 1) : packRange(front + 1, back);
+        if (queue.range.compare_exchange_weak(range, next, memory_order_relaxed))
+            return queue.tiles[steal ? back - 1 : front];
+    }
+}
+
+void runTiles(ThreadPool& pool, const vector<float>& costs, vector<float>& times, const atomic<bool>* cancel,
+              const function<void(int)>& work) {
+    const int tiles = static_cast<int>(costs.size());
+    times.assign(tiles, 0);
+    vector<int> order(tiles);
+    for (int tile = 0; tile < tiles; tile++)
+        order[tile] = tile;
+    // Equal costs keep the row major order.
+    stable_sort(order.begin(), order.end(), [&costs](int a, int b) { return costs[a] > costs[b]; });
+
+    const int threads = pool.getThreadCount();
+    unique_ptr<TileQueue[]> queues(new TileQueue[threads]);
+    for (int i = 0; i < tiles; i++)
+        queues[i % threads].tiles.push_back(order[i]);
+    for (int index = 0; index < threads; index++)
+        queues[index].range.store(packRange(0, static_cast<uint32_t>(queues[index].tiles.size())));
+
+    pool.run([&](int self) {
+        int victim = self;
+        while (true) {
+            int tile = takeTile(queues[self], false);
+            // Once the own queue is empty, go around the others until every queue is.
+            for (int tries = 1; tile < 0 && tries < threads; tries++) {
+                victim = (victim + 1) % threads;
+                if (victim == self)
+                    victim = (victim + 1) % threads;
+                tile = takeTile(queues[victim], true);
+            }
+            if (tile < 0)
+                break;
+            if (cancel != nullptr && cancel->load(memory_order_relaxed))
+                continue;
+            auto start = chrono::steady_clock::now();
+            work(tile);
+            times[tile] = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+        }
+    });
+}
@@ -0,0 +1,19 @@
+#ifndef FRACTALVIEWER_TILESCHEDULER_H
+#define FRACTALVIEWER_TILESCHEDULER_H
+
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "ThreadPool.h"
+using namespace std;
+
+// Runs the tiles of a frame on all threads of the pool. The tiles are sorted by their estimated
+// cost and dealt out round robin, so every thread starts on its most expensive tile and the
+// cheap ones are left for the end. A thread that runs out of tiles steals the cheapest tile
+// left in another thread's queue. Rows of very different cost near the boundary of the set
+// then no longer leave threads idle at the end of a frame.
+// Writes the time every tile took in milliseconds. Tiles are skipped once cancel is set.
+void runTiles(ThreadPool& pool, const vector<float>& costs, vector<float>& times, const atomic<bool>* cancel,
+              const function<void(int)>& work);
+
+#endif //FRACTALVIEWER_TILESCHEDULER_H
@@ -0,0 +1,71 @@
+// Syncs the view of a fractal that never renders, like the one of the viewer's UI thread,
+// into a progressive render between its passes. The passes have to keep the iteration
+// limit of the frame and end on the same image as a render without passes.
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "Fractal.h"
+using namespace std;
+
+static const int width = 320;
+static const int height = 180;
+
+static const vector<PaletteColor> test_colors{
+    {0, 0, 0},
+    {255, 64, 0},
+    {255, 255, 255}
+};
+
+int main() {
+    ThreadPool pool(2);
+    Fractal view(nullptr, true, 1000);
+    view.zoomView(0.3, 0.4, 4);
+
+    PixelBuffer progressive_pixels;
+    progressive_pixels.create(width, height);
+    Fractal worker(&progressive_pixels, true, 1000);
+    worker.setThreadPool(&pool);
+    worker.setProgressive(true);
+    worker.syncView(view);
+    worker.renderFractal(width, height, 0);
+    const int iterations = worker.getIterations();
+    if (iterations == view.getIterations()) {
+        cerr << "The view's limit " << view.getIterations() << " isn't stale, the test proves nothing" << endl;
+        return EXIT_FAILURE;
+    }
+
+    // A palette change submits the view again while the passes are still running.
+    view.setColors(test_colors);
+    int passes = 1;
+    while (worker.needsRender(width, height, 0)) {
+        worker.syncView(view);
+        worker.renderFractal(width, height, 0);
+        passes++;
+        if (worker.getIterations() != iterations) {
+            cerr << "Pass " << passes << " ran " << worker.getIterations() << " iterations instead of "
+                 << iterations << endl;
+            return EXIT_FAILURE;
+        }
+        if (passes > 16) {
+            cerr << "The passes don't end" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    PixelBuffer direct_pixels;
+    direct_pixels.create(width, height);
+    Fractal direct(&direct_pixels, true, 1000);
+    direct.setThreadPool(&pool);
+    direct.syncView(view);
+    direct.renderFractal(width, height, 0);
+    if (direct.getIterations() != iterations) {
+        cerr << "The direct render ran " << direct.getIterations() << " iterations instead of " << iterations << endl;
+        return EXIT_FAILURE;
+    }
+    if (memcmp(progressive_pixels.getPixels(), direct_pixels.getPixels(), static_cast<size_t>(width) * height * 4) != 0) {
+        cerr << "The last pass differs from the render without passes" << endl;
+        return EXIT_FAILURE;
+    }
+    cout << passes << " passes at " << iterations << " iterations" << endl;
+    return EXIT_SUCCESS;
+}